@@ -0,0 +1,84 @@
+var blend = require('..');
+var scenarios = require('./scenarios');
+
+// Measures what a 16-tile stitch allocates per call. Input buffers are read
+// in place by the native side, so neither external memory nor page faults
+// should scale with the size of the inputs. Memory is sampled when a call
+// starts and again in its callback, while anything the call allocated is
+// still alive; a copy of the inputs would show up as about one input size
+// per call. Run with --expose-gc for stable numbers.
+var iterations = 200;
+
+var stitch = scenarios['stitch']();
+var tiles = stitch.images;
+
+// Both forms blend into the same canvas with the same options; bare Buffers
+// just have no offsets.
+var forms = {
+    'objects': tiles,
+    'buffers': tiles.map(function(tile) { return tile.buffer; })
+};
+
+var inputBytes = tiles.reduce(function(sum, tile) { return sum + tile.buffer.length; }, 0);
+
+var hasFaults = typeof process.resourceUsage === 'function';
+
+function sample() {
+    var mem = process.memoryUsage();
+    return {
+        external: mem.external || 0,
+        arrayBuffers: mem.arrayBuffers || 0,
+        rss: mem.rss,
+        faults: hasFaults ? process.resourceUsage().minorPageFault : 0
+    };
+}
+
+function run(name, done) {
+    var images = forms[name];
+    var outputBytes = 0;
+    var external = { sum: 0, max: 0 };
+    var arrayBuffers = { sum: 0, max: 0 };
+    var faults = 0;
+    if (global.gc) global.gc();
+    var rss = process.memoryUsage().rss;
+    var i = 0;
+    (function next() {
+        if (i++ >= iterations) {
+            console.warn('[%s] Iterations: %d', name, iterations);
+            console.warn('[%s] Input bytes per call: %d', name, inputBytes);
+            console.warn('[%s] Output bytes per call: %d', name, Math.round(outputBytes / iterations));
+            console.warn('[%s] External bytes allocated per call besides the output: mean %d, max %d', name,
+                Math.round(external.sum / iterations), external.max);
+            console.warn('[%s] ArrayBuffer bytes allocated per call besides the output: mean %d, max %d', name,
+                Math.round(arrayBuffers.sum / iterations), arrayBuffers.max);
+            if (hasFaults) console.warn('[%s] Minor page faults per call: %d', name, (faults / iterations).toFixed(1));
+            console.warn('[%s] RSS growth: %d kB', name, Math.round((process.memoryUsage().rss - rss) / 1024));
+            return done();
+        }
+        if (global.gc) global.gc();
+        var before = sample();
+        blend(images, stitch.options, function(err, data) {
+            if (err) throw err;
+            var during = sample();
+            outputBytes += data.length;
+            add(external, during.external - before.external - data.length);
+            add(arrayBuffers, during.arrayBuffers - before.arrayBuffers - data.length);
+            faults += during.faults - before.faults;
+            next();
+        });
+    })();
+}
+
+function add(stat, bytes) {
+    bytes = Math.max(0, bytes);
+    stat.sum += bytes;
+    stat.max = Math.max(stat.max, bytes);
+}
+
+if (!global.gc) console.warn('Run with --expose-gc for stable numbers.');
+if (!hasFaults) console.warn('Page fault counts need process.resourceUsage() (Node 12.6+); not reporting them.');
+if (!process.memoryUsage().arrayBuffers) console.warn('ArrayBuffer bytes need Node 13.9+; they read as 0.');
+
+run('objects', function() {
+    run('buffers', function() {});
+});
@@ -0,0 +1,31 @@
+var blend = require('..');
+
+// Parses the tint strings from test/parse-string.test.js over and over. The
+// repeated strings are served from the parse cache; the `unique` pass cycles
+// through more strings than the cache holds, so every call parses.
+var iterations = 1e6;
+
+var strings = {
+    old: ['', '20', '20;40', '30;84;0.5', '30;84;.3;.2', 'ffffff', '94eeff', 'ff7f00', '#4c2d00'],
+    new: ['0.083;0.5;0x1;0x0.5', '0x1;0x1;0x1;0x1', '.5x0;1x0', 'ffffff', 'ff7f00', '#4c2d00'],
+    upgrade: ['', '20', '20;40', '30;84;0.5', '30;84;.3;.2', 'ffffff', 'ff7f00', '#4c2d00']
+};
+
+var unique = [];
+for (var i = 0; i < 5000; i++) unique.push((i / 5000) + 'x1;0x1;0x1;0x1');
+
+function run(name, fn, inputs) {
+    var start = process.hrtime();
+    for (var i = 0; i < iterations; i++) fn(inputs[i % inputs.length], 4);
+    var diff = process.hrtime(start);
+    var seconds = diff[0] + diff[1] / 1e9;
+    console.warn('[%s] %d calls in %ds (%d per second)', name, iterations, seconds.toFixed(3), Math.round(iterations / seconds));
+}
+
+run('parseTintStringOld', blend.parseTintStringOld, strings.old);
+run('parseTintString', blend.parseTintString, strings.new);
+run('upgradeTintString', blend.upgradeTintString, strings.upgrade);
+run('parseTintString unique', blend.parseTintString, unique);
+
+var cache = blend.stats().tintCache;
+console.warn('Cache hits: %d, misses: %d', cache.hits, cache.misses);
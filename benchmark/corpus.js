@@ -0,0 +1,252 @@
+var fs = require('fs');
+var path = require('path');
+var mapnik = require('mapnik');
+
+// Deterministic generator of synthetic tiles with controlled properties, so
+// benchmarks can run against a realistic mix of content without shipping
+// fixtures. The same spec always yields the same pixels.
+//
+// Spec properties:
+// - `seed`: integer, default 1
+// - `width`, `height`: integers, default 256
+// - `entropy`: `flat` (a single color), `vector` (solid shapes, like rendered
+//   map data) or `photo` (smooth noise with grain, like imagery)
+// - `alpha`: fraction of opaque pixels from 0 to 1, default 1; the rest is
+//   fully transparent
+// - `palette`: number of distinct colors, 0 for unlimited (default for photo)
+// - `format`: `png`, `jpeg` or `webp`
+
+// 32-bit integer multiplication; Math.imul is missing on Node 0.10.
+var imul = Math.imul || function(a, b) {
+    var ah = (a >>> 16) & 0xffff, al = a & 0xffff;
+    var bh = (b >>> 16) & 0xffff, bl = b & 0xffff;
+    return ((al * bl) + (((ah * bl + al * bh) << 16) >>> 0)) | 0;
+};
+
+// mulberry32: small, fast and good enough for test content.
+function random(seed) {
+    var state = seed | 0;
+    return function() {
+        state = (state + 0x6D2B79F5) | 0;
+        var t = imul(state ^ (state >>> 15), 1 | state);
+        t = (t + imul(t ^ (t >>> 7), 61 | t)) ^ t;
+        return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+    };
+}
+
+// Smooth noise in 0..1 from bilinearly interpolated random lattices at a few
+// octaves.
+function noise(rand, width, height, cell) {
+    var field = new Float32Array(width * height);
+    var total = 0;
+    for (var size = cell, weight = 1; size >= 4; size /= 2, weight /= 2) {
+        var cols = Math.ceil(width / size) + 1;
+        var rows = Math.ceil(height / size) + 1;
+        var lattice = new Float32Array(cols * rows);
+        for (var i = 0; i < lattice.length; i++) lattice[i] = rand();
+        for (var y = 0; y < height; y++) {
+            var gy = y / size, y0 = Math.floor(gy), fy = gy - y0;
+            for (var x = 0; x < width; x++) {
+                var gx = x / size, x0 = Math.floor(gx), fx = gx - x0;
+                var a = lattice[y0 * cols + x0], b = lattice[y0 * cols + x0 + 1];
+                var c = lattice[(y0 + 1) * cols + x0], d = lattice[(y0 + 1) * cols + x0 + 1];
+                var top = a + (b - a) * fx;
+                var bottom = c + (d - c) * fx;
+                field[y * width + x] += (top + (bottom - top) * fy) * weight;
+            }
+        }
+        total += weight;
+    }
+    for (var j = 0; j < field.length; j++) field[j] /= total;
+    return field;
+}
+
+function makePalette(rand, count) {
+    var colors = [];
+    for (var i = 0; i < count; i++) {
+        colors.push([Math.floor(rand() * 256), Math.floor(rand() * 256), Math.floor(rand() * 256)]);
+    }
+    return colors;
+}
+
+function nearest(colors, r, g, b) {
+    var best = colors[0], distance = Infinity;
+    for (var i = 0; i < colors.length; i++) {
+        var c = colors[i];
+        var d = (c[0] - r) * (c[0] - r) + (c[1] - g) * (c[1] - g) + (c[2] - b) * (c[2] - b);
+        if (d < distance) {
+            distance = d;
+            best = c;
+        }
+    }
+    return best;
+}
+
+function fill(pixels, width, x0, y0, x1, y1, color, test) {
+    for (var y = y0; y < y1; y++) {
+        for (var x = x0; x < x1; x++) {
+            if (test && !test(x, y)) continue;
+            var o = (y * width + x) * 4;
+            pixels[o] = color[0];
+            pixels[o + 1] = color[1];
+            pixels[o + 2] = color[2];
+        }
+    }
+}
+
+function drawVector(rand, pixels, width, height, colors) {
+    fill(pixels, width, 0, 0, width, height, colors[0]);
+    var shapes = 8 + Math.floor(rand() * 24);
+    for (var i = 0; i < shapes; i++) {
+        var color = colors[1 + Math.floor(rand() * (colors.length - 1))] || colors[0];
+        var cx = Math.floor(rand() * width), cy = Math.floor(rand() * height);
+        var kind = rand();
+        if (kind < 0.4) {
+            // Road-like band, horizontal or vertical.
+            var thickness = 2 + Math.floor(rand() * 6);
+            if (rand() < 0.5) fill(pixels, width, 0, cy, width, Math.min(height, cy + thickness), color);
+            else fill(pixels, width, cx, 0, Math.min(width, cx + thickness), height, color);
+        } else if (kind < 0.7) {
+            var w = 8 + Math.floor(rand() * width / 3), h = 8 + Math.floor(rand() * height / 3);
+            fill(pixels, width, cx, cy, Math.min(width, cx + w), Math.min(height, cy + h), color);
+        } else {
+            var radius = 4 + Math.floor(rand() * width / 6);
+            fill(pixels, width, Math.max(0, cx - radius), Math.max(0, cy - radius),
+                Math.min(width, cx + radius), Math.min(height, cy + radius), color,
+                function(x, y) { return (x - cx) * (x - cx) + (y - cy) * (y - cy) <= radius * radius; });
+        }
+    }
+}
+
+function drawPhoto(rand, pixels, width, height, colors) {
+    var channels = [noise(rand, width, height, 64), noise(rand, width, height, 64), noise(rand, width, height, 64)];
+    for (var i = 0, o = 0; i < width * height; i++, o += 4) {
+        var grain = (rand() - 0.5) * 24;
+        var r = Math.max(0, Math.min(255, Math.round(channels[0][i] * 255 + grain)));
+        var g = Math.max(0, Math.min(255, Math.round(channels[1][i] * 255 + grain)));
+        var b = Math.max(0, Math.min(255, Math.round(channels[2][i] * 255 + grain)));
+        if (colors) {
+            var c = nearest(colors, r, g, b);
+            r = c[0]; g = c[1]; b = c[2];
+        }
+        pixels[o] = r;
+        pixels[o + 1] = g;
+        pixels[o + 2] = b;
+    }
+}
+
+// Makes exactly round(coverage * pixels) pixels opaque, in smooth blobs, and
+// clears the others.
+function applyAlpha(rand, pixels, width, height, coverage) {
+    var count = width * height;
+    var opaque = Math.round(Math.max(0, Math.min(1, coverage)) * count);
+    if (opaque === count) {
+        for (var i = 3; i < pixels.length; i += 4) pixels[i] = 255;
+        return;
+    }
+    var field = noise(rand, width, height, 32);
+    var order = new Array(count);
+    for (var j = 0; j < count; j++) order[j] = j;
+    order.sort(function(a, b) { return field[b] - field[a] || a - b; });
+    for (var k = 0; k < count; k++) {
+        var o = order[k] * 4;
+        if (k < opaque) {
+            pixels[o + 3] = 255;
+        } else {
+            pixels[o] = pixels[o + 1] = pixels[o + 2] = pixels[o + 3] = 0;
+        }
+    }
+}
+
+// Returns the raw, unpremultiplied RGBA pixels for a spec.
+function pixels(spec) {
+    var width = spec.width || 256;
+    var height = spec.height || 256;
+    var entropy = spec.entropy || 'vector';
+    var rand = random(spec.seed === undefined ? 1 : spec.seed);
+    var data = new Buffer(width * height * 4);
+    var count = spec.palette !== undefined ? spec.palette : { flat: 1, vector: 8, photo: 0 }[entropy];
+    var colors = count > 0 ? makePalette(rand, count) : null;
+
+    if (entropy === 'flat') fill(data, width, 0, 0, width, height, (colors || makePalette(rand, 1))[0]);
+    else if (entropy === 'vector') drawVector(rand, data, width, height, colors || makePalette(rand, 8));
+    else if (entropy === 'photo') drawPhoto(rand, data, width, height, colors);
+    else throw new Error('Unknown entropy ' + entropy);
+
+    applyAlpha(rand, data, width, height, spec.alpha === undefined ? 1 : spec.alpha);
+    return data;
+}
+
+// Returns the encoded tile for a spec.
+function generate(spec) {
+    var width = spec.width || 256;
+    var height = spec.height || 256;
+    var data = pixels(spec);
+    // The image is a view onto `data`, which stays referenced until encoding is done.
+    var image = mapnik.Image.fromBufferSync(width, height, data, { premultiplied: false });
+    var format = spec.format || 'png';
+    var encoded;
+    if (format === 'png') {
+        // Keep paletted content lossless instead of letting png8 requantize photos.
+        var paletted = spec.palette === undefined ? spec.entropy !== 'photo' : (spec.palette > 0 && spec.palette <= 256);
+        encoded = image.encodeSync(paletted ? 'png8:m=h' : 'png32');
+    } else if (format === 'jpeg') {
+        encoded = image.encodeSync('jpeg85');
+    } else if (format === 'webp') {
+        encoded = image.encodeSync('webp');
+    } else {
+        throw new Error('Unknown format ' + format);
+    }
+    return encoded;
+}
+
+// A fixed mix resembling tile traffic: imagery, rendered vector layers with
+// partial coverage, and flat fills.
+var MIX = [
+    { entropy: 'photo', format: 'jpeg', alpha: 1 },
+    { entropy: 'photo', format: 'webp', alpha: 1 },
+    { entropy: 'vector', format: 'png', alpha: 1, palette: 16 },
+    { entropy: 'vector', format: 'png', alpha: 0.3, palette: 8 },
+    { entropy: 'vector', format: 'png', alpha: 0.05, palette: 4 },
+    { entropy: 'photo', format: 'png', alpha: 0.6 },
+    { entropy: 'flat', format: 'png', alpha: 1 },
+    { entropy: 'flat', format: 'png', alpha: 0 }
+];
+
+// Returns `count` specs cycling through the mix, each with its own seed.
+function mix(count, options) {
+    options = options || {};
+    var specs = [];
+    for (var i = 0; i < count; i++) {
+        var spec = {};
+        var base = MIX[i % MIX.length];
+        for (var key in base) spec[key] = base[key];
+        spec.seed = (options.seed || 1) * 1000 + i;
+        spec.width = options.width || 256;
+        spec.height = options.height || 256;
+        specs.push(spec);
+    }
+    return specs;
+}
+
+module.exports.random = random;
+module.exports.pixels = pixels;
+module.exports.generate = generate;
+module.exports.mix = mix;
+
+// Writes a corpus to disk for inspection:
+//   node benchmark/corpus.js <dir> [count] [seed]
+if (require.main === module) {
+    var dir = process.argv[2];
+    if (!dir) {
+        console.error('Usage: node benchmark/corpus.js <dir> [count] [seed]');
+        process.exit(2);
+    }
+    if (!fs.existsSync(dir)) fs.mkdirSync(dir);
+    mix(+process.argv[3] || MIX.length, { seed: +process.argv[4] || 1 }).forEach(function(spec, i) {
+        var ext = spec.format === 'jpeg' ? 'jpg' : spec.format;
+        var file = path.join(dir, i + '-' + spec.entropy + '-a' + spec.alpha + '-p' + (spec.palette || 0) + '.' + ext);
+        fs.writeFileSync(file, generate(spec));
+        console.warn(file);
+    });
+}
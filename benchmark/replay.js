@@ -0,0 +1,138 @@
+var fs = require('fs');
+var path = require('path');
+var blend = require('..');
+var Queue = require('./queue');
+
+// Replays a session recorded with blend.startRecording() and reports
+// per-stage timings from the `metrics` option.
+var usage = [
+    'Usage: node benchmark/replay.js <dir> [options]',
+    '',
+    'Options:',
+    '  --speed <recorded|max>  keep the recorded arrival times or run back to back (default: recorded)',
+    '  --concurrency <n>       calls in flight with --speed max (default: 10)',
+    '  --json <file>           write the report as JSON, "-" for stdout',
+    ''
+].join('\n');
+
+function parseArgs(argv) {
+    var args = { speed: 'recorded', concurrency: 10 };
+    for (var i = 0; i < argv.length; i++) {
+        var arg = argv[i];
+        switch (arg) {
+            case '--speed': args.speed = argv[++i]; break;
+            case '--concurrency': args.concurrency = +argv[++i]; break;
+            case '--json': args.json = argv[++i]; break;
+            case '--help': args.help = true; break;
+            default:
+                if (arg.indexOf('--') === 0 || args.dir) throw new Error('Unexpected argument ' + arg);
+                args.dir = arg;
+        }
+    }
+    if (!args.help && !args.dir) throw new Error('Missing recording directory');
+    if (args.speed !== 'recorded' && args.speed !== 'max') throw new Error('--speed must be recorded or max');
+    return args;
+}
+
+function load(dir) {
+    var buffers = {};
+    function buffer(hash) {
+        if (!buffers[hash]) buffers[hash] = fs.readFileSync(path.join(dir, 'buffers', hash));
+        return buffers[hash];
+    }
+    return fs.readFileSync(path.join(dir, 'calls.jsonl'), 'utf8').split('\n').filter(Boolean).map(function(line) {
+        var call = JSON.parse(line);
+        call.images = call.images.map(function(image) {
+            image.buffer = buffer(image.buffer);
+            return image;
+        });
+        var options = call.options || {};
+        if (options.palette && options.palette.rgba) {
+            options.palette = new blend.Palette(new Buffer(options.palette.rgba, 'hex'), 'rgba');
+        }
+        options.metrics = true;
+        call.options = options;
+        return call;
+    }).sort(function(a, b) { return a.time - b.time; });
+}
+
+function summarize(values) {
+    values = values.slice().sort(function(a, b) { return a - b; });
+    function at(p) { return values.length ? values[Math.min(values.length - 1, Math.ceil(p * values.length) - 1)] : 0; }
+    var sum = values.reduce(function(a, b) { return a + b; }, 0);
+    return { mean: values.length ? Math.round(sum / values.length) : 0, p50: at(0.5), p95: at(0.95), p99: at(0.99), max: at(1) };
+}
+
+function main() {
+    var args;
+    try {
+        args = parseArgs(process.argv.slice(2));
+    } catch (err) {
+        console.error(err.message);
+        console.error(usage);
+        return process.exit(2);
+    }
+    if (args.help) return console.log(usage);
+
+    var calls = load(args.dir);
+    var samples = { parse: [], wait: [], blend: [], total: [] };
+    var errors = 0;
+    var mismatches = 0;
+    var start = Date.now();
+
+    function replay(call, done) {
+        blend(call.images, call.options, function(err, data, metrics) {
+            if (err) errors++;
+            // A call that failed when recorded should fail again, and vice versa.
+            if (!!err !== !!call.error) mismatches++;
+            if (metrics) {
+                Object.keys(samples).forEach(function(stage) { samples[stage].push(metrics[stage]); });
+            }
+            done();
+        });
+    }
+
+    function finish() {
+        var seconds = (Date.now() - start) / 1000;
+        var report = {
+            calls: calls.length,
+            speed: args.speed,
+            seconds: seconds,
+            perSecond: Math.round(calls.length / seconds * 100) / 100,
+            errors: errors,
+            mismatches: mismatches,
+            stages: {}
+        };
+        Object.keys(samples).forEach(function(stage) { report.stages[stage] = summarize(samples[stage]); });
+
+        console.warn('Calls: %d in %ds (%d per second), %d errors, %d outcome mismatches',
+            report.calls, seconds, report.perSecond, errors, mismatches);
+        Object.keys(report.stages).forEach(function(stage) {
+            var s = report.stages[stage];
+            console.warn('%s µs: mean %d, p50 %d, p95 %d, p99 %d, max %d', stage, s.mean, s.p50, s.p95, s.p99, s.max);
+        });
+        if (args.json === '-') console.log(JSON.stringify(report, null, 2));
+        else if (args.json) fs.writeFileSync(args.json, JSON.stringify(report, null, 2));
+    }
+
+    if (!calls.length) return finish();
+
+    if (args.speed === 'max') {
+        var queue = new Queue(replay, args.concurrency);
+        queue.on('empty', finish);
+        calls.forEach(function(call) { queue.add(call, false); });
+        return queue.start();
+    }
+
+    var remaining = calls.length;
+    var offset = calls[0].time;
+    calls.forEach(function(call) {
+        setTimeout(function() {
+            replay(call, function() {
+                if (!--remaining) finish();
+            });
+        }, call.time - offset);
+    });
+}
+
+main();
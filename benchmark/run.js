@@ -0,0 +1,227 @@
+var fs = require('fs');
+var blend = require('..');
+var Queue = require('./queue');
+var scenarios = require('./scenarios');
+
+var usage = [
+    'Usage: node benchmark/run.js [scenario...] [options]',
+    '',
+    'Runs all scenarios unless some are named. Options:',
+    '  --iterations <n>    measured calls per scenario (default: per scenario)',
+    '  --concurrency <n>   calls in flight (default: per scenario)',
+    '  --warmup <n>        unmeasured calls before measuring (default: 20)',
+    '  --json <file>       write results as JSON, "-" for stdout',
+    '  --compare <file>    compare results against an earlier --json run;',
+    '                      pass two files to compare them without running',
+    '  --threshold <pct>   allowed slowdown before flagging a regression (default: 5)',
+    '  --list              list scenarios',
+    ''
+].join('\n');
+
+function parseArgs(argv) {
+    var args = { names: [], compare: [], warmup: 20, threshold: 5 };
+    for (var i = 0; i < argv.length; i++) {
+        var arg = argv[i];
+        switch (arg) {
+            case '--iterations': args.iterations = +argv[++i]; break;
+            case '--concurrency': args.concurrency = +argv[++i]; break;
+            case '--warmup': args.warmup = +argv[++i]; break;
+            case '--json': args.json = argv[++i]; break;
+            case '--threshold': args.threshold = +argv[++i]; break;
+            case '--compare':
+                while (argv[i + 1] && argv[i + 1].indexOf('--') !== 0) args.compare.push(argv[++i]);
+                break;
+            case '--list': args.list = true; break;
+            case '--help': args.help = true; break;
+            default:
+                if (arg.indexOf('--') === 0) throw new Error('Unknown option ' + arg);
+                if (!scenarios[arg]) throw new Error('Unknown scenario ' + arg);
+                args.names.push(arg);
+        }
+    }
+    return args;
+}
+
+function percentile(sorted, p) {
+    if (!sorted.length) return 0;
+    return sorted[Math.min(sorted.length - 1, Math.max(0, Math.ceil(p * sorted.length) - 1))];
+}
+
+function round(value, digits) {
+    var factor = Math.pow(10, digits);
+    return Math.round(value * factor) / factor;
+}
+
+// Runs `count` calls with at most `concurrency` in flight and passes the
+// latency of each call in milliseconds to the callback. Scenarios blend
+// their `images` with their `options`, unless they bring their own `run`.
+function runCalls(scenario, count, concurrency, callback) {
+    var latencies = [];
+    var result = null;
+    if (!count) return callback(null, latencies, result);
+    var failed = null;
+    var queue = new Queue(function(i, done) {
+        var start = process.hrtime();
+        var call = scenario.run || function(cb) { blend(scenario.images, scenario.options, cb); };
+        call(function(err, data) {
+            var diff = process.hrtime(start);
+            if (err) failed = failed || err;
+            latencies.push(diff[0] * 1e3 + diff[1] / 1e6);
+            result = result || data;
+            done();
+        });
+    }, concurrency);
+    queue.on('empty', function() {
+        callback(failed, latencies, result);
+    });
+    for (var i = 0; i < count; i++) queue.add(i, false);
+    queue.start();
+}
+
+// Scenarios that need an optional dependency return nothing without it;
+// they are passed to the callback as null.
+function runScenario(name, args, callback) {
+    var scenario = scenarios[name]();
+    if (!scenario) return callback(null, null);
+    var iterations = args.iterations || scenario.iterations;
+    var concurrency = args.concurrency || scenario.concurrency;
+
+    runCalls(scenario, args.warmup, concurrency, function(err) {
+        if (err) return callback(err);
+        if (global.gc) global.gc();
+
+        var peakRSS = process.memoryUsage().rss;
+        var sampler = setInterval(function() {
+            peakRSS = Math.max(peakRSS, process.memoryUsage().rss);
+        }, 20);
+        var start = process.hrtime();
+
+        runCalls(scenario, iterations, concurrency, function(err, latencies, data) {
+            var diff = process.hrtime(start);
+            clearInterval(sampler);
+            if (err) return callback(err);
+            peakRSS = Math.max(peakRSS, process.memoryUsage().rss);
+
+            var seconds = diff[0] + diff[1] / 1e9;
+            var info = data && blend.probe(data);
+            var pixels = info ? info.width * info.height : 0;
+            latencies.sort(function(a, b) { return a - b; });
+            callback(null, {
+                name: name,
+                description: scenario.description,
+                iterations: iterations,
+                concurrency: concurrency,
+                seconds: round(seconds, 3),
+                perSecond: round(iterations / seconds, 2),
+                mpixPerSecond: round(iterations * pixels / seconds / 1e6, 2),
+                latency: {
+                    min: round(latencies[0], 3),
+                    p50: round(percentile(latencies, 0.50), 3),
+                    p95: round(percentile(latencies, 0.95), 3),
+                    p99: round(percentile(latencies, 0.99), 3),
+                    max: round(latencies[latencies.length - 1], 3)
+                },
+                peakRSS: peakRSS,
+                bytesOut: data ? data.length : 0
+            });
+        });
+    });
+}
+
+function report(result) {
+    console.warn('[%s] %s', result.name, result.description);
+    console.warn('[%s] Iterations: %d, concurrency: %d', result.name, result.iterations, result.concurrency);
+    console.warn('[%s] Per second: %d (%d MPix/s)', result.name, result.perSecond, result.mpixPerSecond);
+    console.warn('[%s] Latency ms: p50 %d, p95 %d, p99 %d, max %d', result.name,
+        result.latency.p50, result.latency.p95, result.latency.p99, result.latency.max);
+    console.warn('[%s] Peak RSS: %d MB', result.name, Math.round(result.peakRSS / 1048576));
+}
+
+// Flags scenarios whose throughput dropped or whose p95 latency grew by more
+// than `threshold` percent. Returns the number of regressions.
+function compare(base, head, threshold) {
+    var regressions = 0;
+    var byName = {};
+    base.results.forEach(function(result) { byName[result.name] = result; });
+    head.results.forEach(function(result) {
+        var before = byName[result.name];
+        if (!before) return console.warn('[%s] not in baseline', result.name);
+        var throughput = (result.perSecond - before.perSecond) / before.perSecond * 100;
+        var p95 = (result.latency.p95 - before.latency.p95) / before.latency.p95 * 100;
+        var regressed = throughput < -threshold || p95 > threshold;
+        if (regressed) regressions++;
+        console.warn('[%s] per second %d -> %d (%s%%), p95 %d -> %d ms (%s%%)%s', result.name,
+            before.perSecond, result.perSecond, (throughput >= 0 ? '+' : '') + throughput.toFixed(1),
+            before.latency.p95, result.latency.p95, (p95 >= 0 ? '+' : '') + p95.toFixed(1),
+            regressed ? '  REGRESSION' : '');
+    });
+    return regressions;
+}
+
+function readRun(file) {
+    return JSON.parse(fs.readFileSync(file, 'utf8'));
+}
+
+function main() {
+    var args;
+    try {
+        args = parseArgs(process.argv.slice(2));
+    } catch (err) {
+        console.error(err.message);
+        console.error(usage);
+        return process.exit(2);
+    }
+    if (args.help) return console.log(usage);
+    if (args.list) {
+        return Object.keys(scenarios).forEach(function(name) {
+            var scenario = scenarios[name]();
+            console.log('%s: %s', name, scenario ? scenario.description : '(unavailable)');
+        });
+    }
+    if (args.compare.length > 2) {
+        console.error('--compare takes one or two files');
+        return process.exit(2);
+    }
+    if (args.compare.length === 2) {
+        var regressions = compare(readRun(args.compare[0]), readRun(args.compare[1]), args.threshold);
+        return process.exit(regressions ? 1 : 0);
+    }
+
+    var names = args.names.length ? args.names : Object.keys(scenarios);
+    var run = {
+        node: process.version,
+        platform: process.platform,
+        arch: process.arch,
+        cpus: require('os').cpus().length,
+        threadpool: +process.env.UV_THREADPOOL_SIZE || 4,
+        date: new Date().toISOString(),
+        results: []
+    };
+
+    (function next(i) {
+        if (i >= names.length) return finish(run, args);
+        runScenario(names[i], args, function(err, result) {
+            if (err) throw err;
+            if (!result) {
+                console.warn('[%s] skipped: needs a module that is not installed', names[i]);
+                return next(i + 1);
+            }
+            report(result);
+            run.results.push(result);
+            next(i + 1);
+        });
+    })(0);
+}
+
+function finish(run, args) {
+    if (args.json === '-') console.log(JSON.stringify(run, null, 2));
+    else if (args.json) fs.writeFileSync(args.json, JSON.stringify(run, null, 2));
+    if (args.compare.length === 1) {
+        process.exit(compare(readRun(args.compare[0]), run, args.threshold) ? 1 : 0);
+    }
+}
+
+if (require.main === module) main();
+
+module.exports.runScenario = runScenario;
+module.exports.percentile = percentile;
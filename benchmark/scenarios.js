@@ -0,0 +1,166 @@
+var fs = require('fs');
+var path = require('path');
+var blend = require('..');
+var corpus = require('./corpus');
+
+// Named benchmark scenarios. Each one is a function so that fixtures are
+// only read for the scenarios that actually run. `iterations` and
+// `concurrency` are defaults that run.js can override.
+var fixture = path.join(__dirname, '..', 'test', 'fixture');
+
+function read(file) {
+    return fs.readFileSync(path.join(fixture, file));
+}
+
+module.exports = {
+    'stitch': function() {
+        var images = [];
+        [12663, 12664, 12665, 12666].forEach(function(y, row) {
+            [5241, 5242, 5243, 5244].forEach(function(x, col) {
+                images.push({ buffer: read(x + '-' + y + '.png'), x: -43 + col * 256, y: -120 + row * 256 });
+            });
+        });
+        return {
+            description: '16 PNG tiles stitched into a 700x600 PNG (hextree)',
+            images: images,
+            options: { width: 700, height: 600, quality: 256, encoder: 'libpng', mode: 'hextree' },
+            iterations: 500,
+            concurrency: 10
+        };
+    },
+
+    'stitch-compiled': function() {
+        var scenario = module.exports['stitch']();
+        scenario.description = '16 PNG tiles stitched into a 700x600 PNG (hextree), options from compileOptions()';
+        scenario.options = blend.compileOptions(scenario.options);
+        return scenario;
+    },
+
+    'stitch-files': function() {
+        var images = [];
+        [12663, 12664, 12665, 12666].forEach(function(y, row) {
+            [5241, 5242, 5243, 5244].forEach(function(x, col) {
+                images.push({ path: path.join(fixture, x + '-' + y + '.png'), x: -43 + col * 256, y: -120 + row * 256 });
+            });
+        });
+        return {
+            description: '16 PNG tiles read by path and stitched into a 700x600 PNG (hextree)',
+            images: images,
+            options: { width: 700, height: 600, quality: 256, encoder: 'libpng', mode: 'hextree' },
+            iterations: 500,
+            concurrency: 10
+        };
+    },
+
+    // The same stitch with node-canvas, for comparison. Only available
+    // when the optional `canvas` module is installed.
+    'stitch-canvas': function() {
+        var Canvas;
+        try {
+            Canvas = require('canvas');
+        } catch (err) {
+            return null;
+        }
+        var stitch = module.exports['stitch']();
+        return {
+            description: '16 PNG tiles stitched into a 700x600 PNG with node-canvas',
+            run: function(callback) {
+                var canvas = new Canvas(stitch.options.width, stitch.options.height);
+                var ctx = canvas.getContext('2d');
+                stitch.images.forEach(function(tile) {
+                    var image = new Canvas.Image();
+                    image.src = tile.buffer;
+                    ctx.drawImage(image, tile.x, tile.y);
+                });
+                canvas.toBuffer(callback);
+            },
+            iterations: stitch.iterations,
+            concurrency: stitch.concurrency
+        };
+    },
+
+    'tint': function() {
+        return {
+            description: '2 tinted PNG layers into a 256x256 PNG (hextree)',
+            images: [
+                { buffer: read('tinting/iceland.png'), tint: blend.parseTintString(blend.upgradeTintString('30;50')) },
+                { buffer: read('tinting/heat.png'), tint: { h: [0.5, 1], s: [1, 1], l: [0, 1], a: [0, 1] } }
+            ],
+            options: { width: 256, height: 256, quality: 256, encoder: 'libpng', mode: 'hextree' },
+            iterations: 100,
+            concurrency: 10
+        };
+    },
+
+    'tint-mixed': function() {
+        return {
+            description: '1 tinted JPEG and 3 tinted PNG layers into a 256x256 PNG (hextree)',
+            images: [
+                { buffer: read('tinting/landsat3.jpg'), tint: blend.parseTintString('.1x1;0x1;0x1;0x1') },
+                { buffer: read('tinting/heat.png'), tint: blend.parseTintString('0x1;0x.5;0x.5;0x1') },
+                { buffer: read('tinting/borders.png'), tint: blend.parseTintString('0x1;0x0;1x1;0x.5') },
+                { buffer: read('tinting/overlay.png'), tint: blend.parseTintString('.85x1;.5x1;0x1;0x.8') }
+            ],
+            options: { width: 256, height: 256, quality: 256, encoder: 'libpng', mode: 'hextree' },
+            iterations: 200,
+            concurrency: 10
+        };
+    },
+
+    'reencode-jpeg': function() {
+        return {
+            description: 'WebP reencoded as JPEG',
+            images: [ read('tinting/iceland.webp') ],
+            options: { reencode: true, format: 'jpeg' },
+            iterations: 1000,
+            concurrency: 10
+        };
+    },
+
+    'reencode-png': function() {
+        return {
+            description: 'PNG reencoded as 256 color PNG',
+            images: [ read('tinting/iceland.png') ],
+            options: { reencode: true, format: 'png', quality: 256 },
+            iterations: 100,
+            concurrency: 10
+        };
+    },
+
+    'reencode-webp': function() {
+        return {
+            description: 'PNG reencoded as WebP',
+            images: [ read('tinting/iceland.png') ],
+            options: { reencode: true, format: 'webp', compression: 1 },
+            iterations: 500,
+            concurrency: 10
+        };
+    },
+
+    'synthetic-stitch': function() {
+        var images = corpus.mix(16).map(function(spec, i) {
+            return { buffer: corpus.generate(spec), x: (i % 4) * 256, y: Math.floor(i / 4) * 256 };
+        });
+        return {
+            description: '16 synthetic tiles (imagery, vector, flat; mixed formats and alpha) stitched into a 1024x1024 PNG',
+            images: images,
+            options: { width: 1024, height: 1024, quality: 256, encoder: 'libpng', mode: 'hextree' },
+            iterations: 100,
+            concurrency: 10
+        };
+    },
+
+    'synthetic-overlay': function() {
+        return {
+            description: 'Synthetic imagery with 2 partially transparent vector layers into a 256x256 JPEG',
+            images: [
+                { entropy: 'photo', format: 'jpeg', alpha: 1, seed: 1 },
+                { entropy: 'vector', format: 'png', alpha: 0.3, palette: 8, seed: 2 },
+                { entropy: 'vector', format: 'png', alpha: 0.05, palette: 4, seed: 3 }
+            ].map(corpus.generate),
+            options: { width: 256, height: 256, format: 'jpeg', quality: 80 },
+            iterations: 500,
+            concurrency: 10
+        };
+    }
+};
@@ -0,0 +1,45 @@
+var blend = require('..');
+var scenarios = require('./scenarios');
+var Queue = require('./queue');
+
+// Keeps 50 stitches in flight and samples RSS next to blend's own estimate
+// of native memory. RSS should level off instead of growing with the
+// number of iterations.
+var iterations = 2000;
+var concurrency = 50;
+
+var stitch = scenarios['stitch']();
+
+var peakRSS = 0;
+var sampler = setInterval(function() {
+    peakRSS = Math.max(peakRSS, process.memoryUsage().rss);
+}, 50);
+
+var queue = new Queue(function(i, done) {
+    blend(stitch.images, stitch.options, function(err) {
+        if (err) throw err;
+        if (i % 500 === 0) {
+            console.warn('[%d] RSS: %d MB, native estimate: %d MB', i,
+                Math.round(process.memoryUsage().rss / 1048576),
+                Math.round(blend.memoryUsage().current / 1048576));
+        }
+        done();
+    });
+}, concurrency);
+
+queue.on('empty', function() {
+    clearInterval(sampler);
+    var msec = Date.now() - start;
+    console.warn('Iterations: %d', iterations);
+    console.warn('Concurrency: %d', concurrency);
+    console.warn('Per second: %d', iterations / (msec / 1000));
+    console.warn('Peak RSS: %d MB', Math.round(peakRSS / 1048576));
+    console.warn('Peak native estimate: %d MB', Math.round(blend.memoryUsage().peak / 1048576));
+});
+
+for (var i = 1; i <= iterations; i++) {
+    queue.add(i, false);
+}
+
+var start = Date.now();
+queue.start();
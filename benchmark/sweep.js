@@ -0,0 +1,150 @@
+var fs = require('fs');
+var os = require('os');
+var spawnSync = require('child_process').spawnSync;
+var scenarios = require('./scenarios');
+var runScenario = require('./run').runScenario;
+
+// Runs scenarios from run.js over a grid of threadpool sizes and concurrency
+// levels to show where throughput stops scaling. The threadpool size is fixed
+// when a process starts, so every point runs in a child process: this script
+// again with --point, which measures one scenario with run.js's runner.
+var usage = [
+    'Usage: node benchmark/sweep.js [scenario...] [options]',
+    '',
+    'Runs the stitch scenario unless some are named. Options:',
+    '  --threads <list>      comma separated UV_THREADPOOL_SIZE values (default: 1,2,4,... up to the CPU count)',
+    '  --concurrency <list>  comma separated calls in flight (default: same as --threads)',
+    '  --iterations <n>      measured calls per point (default: per scenario)',
+    '  --warmup <n>          unmeasured calls per point (default: 20)',
+    '  --json <file>         write the curves as JSON, "-" for stdout',
+    ''
+].join('\n');
+
+function powersOfTwo(max) {
+    var values = [];
+    for (var i = 1; i < max; i *= 2) values.push(i);
+    values.push(max);
+    return values;
+}
+
+function parseList(value) {
+    return value.split(',').map(function(v) { return +v; }).filter(function(v) { return v > 0; });
+}
+
+function parseArgs(argv) {
+    var args = { names: [], warmup: 20 };
+    for (var i = 0; i < argv.length; i++) {
+        var arg = argv[i];
+        switch (arg) {
+            case '--threads': args.threads = parseList(argv[++i]); break;
+            case '--concurrency': args.concurrency = parseList(argv[++i]); break;
+            case '--iterations': args.iterations = +argv[++i]; break;
+            case '--warmup': args.warmup = +argv[++i]; break;
+            case '--json': args.json = argv[++i]; break;
+            case '--help': args.help = true; break;
+            default:
+                if (arg.indexOf('--') === 0) throw new Error('Unknown option ' + arg);
+                if (!scenarios[arg]) throw new Error('Unknown scenario ' + arg);
+                args.names.push(arg);
+        }
+    }
+    if (!args.names.length) args.names.push('stitch');
+    args.threads = args.threads || powersOfTwo(os.cpus().length);
+    args.concurrency = args.concurrency || args.threads;
+    return args;
+}
+
+function runPoint(name, threads, concurrency, args) {
+    var point = { name: name, concurrency: concurrency, warmup: args.warmup, iterations: args.iterations };
+    var argv = [__filename, '--point', JSON.stringify(point)];
+    var env = {};
+    for (var key in process.env) env[key] = process.env[key];
+    env.UV_THREADPOOL_SIZE = String(threads);
+    var child = spawnSync(process.execPath, argv, { env: env, encoding: 'utf8', maxBuffer: 1 << 24 });
+    if (child.status !== 0) {
+        throw new Error('Sweep failed for ' + name + ' at ' + threads + ' threads, concurrency ' + concurrency + ':\n' + child.stderr);
+    }
+    return JSON.parse(child.stdout);
+}
+
+// Child side of runPoint(): measures one point and writes the result as JSON.
+function measurePoint(point) {
+    runScenario(point.name, point, function(err, result) {
+        if (err) throw err;
+        if (!result) throw new Error('Scenario ' + point.name + ' needs a module that is not installed');
+        console.log(JSON.stringify(result));
+    });
+}
+
+function main() {
+    if (process.argv[2] === '--point') return measurePoint(JSON.parse(process.argv[3]));
+    if (!spawnSync) {
+        console.error('sweep.js needs child_process.spawnSync, which is available from Node 0.12.');
+        return process.exit(2);
+    }
+
+    var args;
+    try {
+        args = parseArgs(process.argv.slice(2));
+    } catch (err) {
+        console.error(err.message);
+        console.error(usage);
+        return process.exit(2);
+    }
+    if (args.help) return console.log(usage);
+
+    var sweep = {
+        node: process.version,
+        platform: process.platform,
+        arch: process.arch,
+        cpus: os.cpus().length,
+        date: new Date().toISOString(),
+        curves: []
+    };
+
+    args.names.forEach(function(name) {
+        var best = null;
+        console.warn('[%s] threads  concurrency  per second  p50 ms  p99 ms', name);
+        args.threads.forEach(function(threads) {
+            args.concurrency.forEach(function(concurrency) {
+                var result = runPoint(name, threads, concurrency, args);
+                var point = {
+                    scenario: name,
+                    threads: threads,
+                    concurrency: concurrency,
+                    perSecond: result.perSecond,
+                    mpixPerSecond: result.mpixPerSecond,
+                    latency: result.latency,
+                    peakRSS: result.peakRSS
+                };
+                sweep.curves.push(point);
+                if (!best || point.perSecond > best.perSecond) best = point;
+                console.warn('[%s] %s  %s  %s  %s  %s', name,
+                    pad(threads, 7), pad(concurrency, 11), pad(point.perSecond, 10),
+                    pad(point.latency.p50, 6), pad(point.latency.p99, 6));
+            });
+        });
+        // The smallest configuration within 5% of the best one is where
+        // adding threads or concurrency stops paying off.
+        var saturation = sweep.curves.filter(function(point) {
+            return point.scenario === name && point.perSecond >= best.perSecond * 0.95;
+        }).sort(function(a, b) {
+            return a.threads - b.threads || a.concurrency - b.concurrency;
+        })[0];
+        console.warn('[%s] Best: %d per second at %d threads, concurrency %d', name,
+            best.perSecond, best.threads, best.concurrency);
+        console.warn('[%s] Within 5%% of best from %d threads, concurrency %d', name,
+            saturation.threads, saturation.concurrency);
+    });
+
+    if (args.json === '-') console.log(JSON.stringify(sweep, null, 2));
+    else if (args.json) fs.writeFileSync(args.json, JSON.stringify(sweep, null, 2));
+}
+
+function pad(value, width) {
+    value = String(value);
+    while (value.length < width) value = ' ' + value;
+    return value;
+}
+
+main();
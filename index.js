@@ -1,11 +1,1561 @@
 var mapnik = require('mapnik');
-module.exports = mapnik.blend;
+var crypto = require('crypto');
+var fs = require('fs');
+var path = require('path');
+
+// Estimated native memory held by blend() jobs that have not called back
+// yet. node-mapnik allocates canvases, decoded layers and encoder output
+// outside of the V8 heap, so this is the only view JS gets of them.
+var memory = {
+    current: 0,
+    peak: 0,
+    jobs: 0,
+    queued: 0,
+    waited: 0,
+    rejected: 0,
+    waitTime: 0,
+    maxWaitTime: 0,
+    decodedImages: 0,
+    decodedBytes: 0
+};
+
+var config = {
+    maxInFlightBytes: 0,
+    maxQueued: Infinity
+};
+
+// Jobs waiting for memory to become available, in arrival order.
+var pending = [];
+
+module.exports = blend;
+function blend(images, options, callback) {
+    if (typeof options === 'function') {
+        callback = options;
+        options = undefined;
+    }
+    // Let node-mapnik report a missing callback.
+    if (typeof callback !== 'function') return mapnik.blend.apply(mapnik, arguments);
+
+    var start = process.hrtime();
+    var pinned = pinDecoded(images);
+    if (hasFiles(images)) {
+        return readFiles(images, function(err, images) {
+            if (err) return callback(err);
+            // Argument errors can no longer be thrown to the caller.
+            try {
+                submit(images, options, callback, start, pinned);
+            } catch (err) {
+                callback(err);
+            }
+        });
+    }
+    submit(images, options, callback, start, pinned);
+}
+
+function submit(images, options, callback, start, pinned) {
+    var metrics = options && options.metrics;
+    var compiled = options instanceof CompiledOptions ? options : null;
+    if (compiled) options = compiled.options;
+    else if (metrics) options = without(options, 'metrics');
+
+    var job = {
+        images: images,
+        options: options,
+        format: compiled ? compiled.format : outputFormat(options),
+        encoding: compiled ? compiled.encoding : null,
+        callback: callback,
+        start: start,
+        plan: plan(images, options),
+        composite: needsComposite(images),
+        pinned: pinned,
+        bytes: 0,
+        queued: 0,
+        metrics: null,
+        trace: null,
+        recorder: null
+    };
+    // The composite path holds all decoded layers at once.
+    job.bytes = job.composite ? job.plan.pixels * 4 * 2 + job.plan.decoded : job.plan.bytes;
+    if (metrics) job.metrics = createMetrics(job);
+    if (traceEnabled()) traceStart(job);
+    if (recorder && Math.random() < recorder.sampleRate) job.recorder = recorder;
+
+    var limit = config.maxInFlightBytes;
+    if (!limit || (!pending.length && memory.current + job.bytes <= limit)) {
+        return run(job);
+    }
+
+    var err;
+    if (job.bytes > limit) {
+        err = new Error('Job needs an estimated ' + job.bytes + ' bytes which exceeds maxInFlightBytes (' + limit + ')');
+    } else if (pending.length >= config.maxQueued) {
+        err = new Error('Too many blend jobs waiting for memory (maxQueued is ' + config.maxQueued + ')');
+    }
+    if (err) {
+        memory.rejected++;
+        return process.nextTick(function() { finish(job, err); });
+    }
+
+    job.queued = Date.now();
+    if (job.metrics) job.metrics.queued = process.hrtime();
+    if (job.trace) traceSpan(job, 'wait', true);
+    pending.push(job);
+    memory.queued = pending.length;
+}
+
+// Images can be given as `{ path }` or `{ fd, offset, length }` instead of
+// `{ buffer }`. Files are read on the threadpool before the job is planned,
+// so callers don't need to block on readFileSync().
+function hasFiles(images) {
+    if (!Array.isArray(images)) return false;
+    var found = false;
+    for (var i = 0; i < images.length; i++) {
+        var image = images[i];
+        if (!image || Buffer.isBuffer(image) || image.buffer !== undefined) continue;
+        if (image.path !== undefined) {
+            if (typeof image.path !== 'string' || !image.path) throw new TypeError('path must be a non-empty string');
+            found = true;
+        } else if (image.fd !== undefined) {
+            if (!isIndex(image.fd)) throw new TypeError('fd must be an integer >= 0');
+            if (image.offset !== undefined && !isIndex(image.offset)) throw new TypeError('offset must be an integer >= 0');
+            if (image.length !== undefined && !isIndex(image.length)) throw new TypeError('length must be an integer >= 0');
+            found = true;
+        }
+    }
+    return found;
+}
+
+function isIndex(value) {
+    return typeof value === 'number' && value >= 0 && value % 1 === 0;
+}
+
+// Returns a copy of `images` with files replaced by `{ buffer }` objects.
+function readFiles(images, callback) {
+    var result = new Array(images.length);
+    var remaining = images.length;
+    var failed = null;
+    images.forEach(function(image, i) {
+        if (!image || Buffer.isBuffer(image) || image.buffer !== undefined ||
+            (image.path === undefined && image.fd === undefined)) {
+            result[i] = image;
+            return done();
+        }
+        var read = image.path !== undefined ?
+            function(cb) { fs.readFile(image.path, cb); } :
+            function(cb) { readRange(image.fd, image.offset || 0, image.length, cb); };
+        read(function(err, buffer) {
+            if (err) {
+                failed = failed || err;
+                return done();
+            }
+            var copy = { buffer: buffer };
+            for (var key in image) {
+                if (key !== 'path' && key !== 'fd' && key !== 'offset' && key !== 'length') copy[key] = image[key];
+            }
+            result[i] = copy;
+            done();
+        });
+    });
+    function done() {
+        if (--remaining) return;
+        callback(failed, failed ? null : result);
+    }
+}
+
+// Reads `length` bytes at `offset` of a file descriptor, or up to the end of
+// the file without a length.
+function readRange(fd, offset, length, callback) {
+    if (length === undefined) {
+        return fs.fstat(fd, function(err, stat) {
+            if (err) return callback(err);
+            readRange(fd, offset, Math.max(0, stat.size - offset), callback);
+        });
+    }
+    var buffer = new Buffer(length);
+    (function next(filled) {
+        if (filled === length) return callback(null, buffer);
+        fs.read(fd, buffer, filled, length - filled, offset + filled, function(err, bytes) {
+            if (err) return callback(err);
+            if (!bytes) return callback(new Error('Unexpected end of file reading fd ' + fd));
+            next(filled + bytes);
+        });
+    })(0);
+}
+
+// Starts a job. node-mapnik decodes, tints, composites, quantizes and
+// encodes in a single threadpool task, so JS can only time it as a whole:
+// the `blend` stage of metrics and traces covers all of those, including
+// time spent waiting for a free threadpool thread. The composite path runs
+// the same stages as several tasks and is timed the same way.
+function run(job) {
+    acquire(job.bytes);
+    var started = job.metrics ? process.hrtime() : null;
+    if (started && job.metrics.queued) job.metrics.wait = micros(job.metrics.queued);
+    if (job.trace) {
+        if (job.trace.wait) traceSpan(job, 'wait', false);
+        traceSpan(job, 'blend', true);
+    }
+    var done = function(err, data) {
+        release(job.bytes);
+        if (started) {
+            job.metrics.blend = micros(started);
+            if (data) job.metrics.bytesOut = data.length;
+        }
+        finish(job, err, data);
+    };
+    try {
+        if (job.composite) composite(job, done);
+        else if (job.options === undefined) mapnik.blend(job.images, done);
+        else mapnik.blend(job.images, job.options, done);
+    } catch (err) {
+        release(job.bytes);
+        // Jobs started from the queue have no caller left to throw to.
+        if (!job.queued) {
+            if (job.trace) traceEnd(job);
+            throw err;
+        }
+        finish(job, err);
+    }
+}
+
+function finish(job, err, data) {
+    var total = micros(job.start);
+    record(job, err, data, total);
+    if (job.trace) traceEnd(job);
+    if (job.recorder) capture(job, err, data, total);
+    if (!job.metrics) return job.callback(err, data);
+    var metrics = job.metrics;
+    metrics.total = total;
+    delete metrics.queued;
+    job.callback(err, data, metrics);
+}
+
+// Timings are in microseconds; see run() for what `blend` covers.
+function createMetrics(job) {
+    var bytesIn = 0;
+    var images = Array.isArray(job.images) ? job.images : [];
+    for (var i = 0; i < images.length; i++) {
+        var buffer = Buffer.isBuffer(images[i]) ? images[i] : images[i] && images[i].buffer;
+        if (Buffer.isBuffer(buffer)) bytesIn += buffer.length;
+    }
+    return {
+        queued: null,
+        parse: micros(job.start),
+        wait: 0,
+        blend: 0,
+        total: 0,
+        layers: images.length,
+        bytesIn: bytesIn,
+        bytesOut: 0
+    };
+}
+
+// Spans are emitted through console.time()/timeEnd(), the only public API
+// that writes to Node's trace log; trace_events can't emit events under a
+// category of our own, so they show up in the `node.console` category as
+// `time::node-blend.*`. The console writes its timings to a stream that
+// discards them. Jobs aren't traced unless the category is enabled.
+//
+// Whether it is enabled is checked once a second rather than per job, so
+// the disabled path costs one property read. Categories enabled at startup
+// (--trace-event-categories) are seen right away.
+var tracing = null;
+try {
+    var traceEvents = require('trace_events');
+    if (typeof traceEvents.getEnabledCategories === 'function') {
+        var Writable = require('stream').Writable;
+        var sink = new Writable();
+        sink._write = function(chunk, encoding, callback) { callback(); };
+        tracing = {
+            console: new console.Console(sink),
+            enabled: false,
+            id: 0
+        };
+        var refreshTracing = function() {
+            var categories = traceEvents.getEnabledCategories();
+            tracing.enabled = !!categories && categories.split(',').indexOf('node.console') !== -1;
+        };
+        refreshTracing();
+        setInterval(refreshTracing, 1000).unref();
+    }
+} catch (err) {}
+
+function traceEnabled() {
+    return tracing !== null && tracing.enabled;
+}
+
+// Labels must be unique while a span is open, so each job gets an id. The
+// label also carries the layer count and canvas size, which shows them in
+// the trace viewer.
+function traceStart(job) {
+    var plan = job.plan;
+    var suffix = ' #' + (++tracing.id) + ' (' + plan.formats.length + ' layers, ' + plan.width + 'x' + plan.height + ')';
+    job.trace = { suffix: suffix, wait: false, blend: false };
+    tracing.console.time('node-blend.job' + suffix);
+}
+
+function traceSpan(job, name, open) {
+    if (open) tracing.console.time('node-blend.' + name + job.trace.suffix);
+    else tracing.console.timeEnd('node-blend.' + name + job.trace.suffix);
+    job.trace[name] = open;
+}
+
+// `node-blend.blend` covers the same stages as the `blend` metric; see run().
+function traceEnd(job) {
+    if (job.trace.wait) traceSpan(job, 'wait', false);
+    if (job.trace.blend) traceSpan(job, 'blend', false);
+    tracing.console.timeEnd('node-blend.job' + job.trace.suffix);
+}
+
+function micros(start) {
+    var diff = process.hrtime(start);
+    return Math.round(diff[0] * 1e6 + diff[1] / 1e3);
+}
+
+function without(object, key) {
+    var copy = {};
+    for (var k in object) {
+        if (k !== key) copy[k] = object[k];
+    }
+    return copy;
+}
+
+function acquire(bytes) {
+    memory.current += bytes;
+    memory.jobs++;
+    if (memory.current > memory.peak) memory.peak = memory.current;
+}
+
+function release(bytes) {
+    memory.current -= bytes;
+    memory.jobs--;
+    drain();
+}
+
+// Starts queued jobs that fit in the budget, and fails those that can never
+// fit after the limit was lowered. This runs on the next tick so that jobs
+// and their callbacks never run inside a caller's configure() or inside
+// another job's completion.
+var draining = false;
+
+function drain() {
+    if (draining || !pending.length) return;
+    draining = true;
+    process.nextTick(function() {
+        draining = false;
+        var limit = config.maxInFlightBytes;
+        while (pending.length) {
+            var job = pending[0];
+            if (limit && job.bytes > limit) {
+                pending.shift();
+                memory.queued = pending.length;
+                memory.rejected++;
+                finish(job, new Error('Job needs an estimated ' + job.bytes + ' bytes which exceeds maxInFlightBytes (' + limit + ')'));
+                continue;
+            }
+            if (limit && memory.current + job.bytes > limit) break;
+            pending.shift();
+            var wait = Date.now() - job.queued;
+            memory.queued = pending.length;
+            memory.waited++;
+            memory.waitTime += wait;
+            if (wait > memory.maxWaitTime) memory.maxWaitTime = wait;
+            run(job);
+        }
+    });
+}
+
+// Sets process-wide limits. `maxInFlightBytes` caps the estimated native
+// memory of running jobs; jobs that would exceed it wait until enough
+// memory is released. `maxQueued` caps the number of waiting jobs.
+module.exports.configure = function(options) {
+    if (!options || typeof options !== 'object') throw new TypeError('options must be an object');
+    if ('maxInFlightBytes' in options) {
+        var bytes = options.maxInFlightBytes;
+        if (typeof bytes !== 'number' || bytes < 0) throw new TypeError('maxInFlightBytes must be a number >= 0');
+        config.maxInFlightBytes = bytes;
+    }
+    if ('maxQueued' in options) {
+        var queued = options.maxQueued;
+        if (typeof queued !== 'number' || queued < 0) throw new TypeError('maxQueued must be a number >= 0');
+        config.maxQueued = queued;
+    }
+    drain();
+};
+
+// Probes the inputs of a blend() call. `bytes` is a rough upper bound of the
+// native memory it needs: the canvas, the largest decoded layer (layers are
+// decoded one at a time) and another canvas worth of quantizer/encoder
+// scratch.
+function plan(images, options) {
+    var formats = [];
+    if (!Array.isArray(images)) return { bytes: 0, width: 0, height: 0, pixels: 0, decoded: 0, formats: formats };
+    var width = options && options.width > 0 ? options.width : 0;
+    var height = options && options.height > 0 ? options.height : 0;
+    var extentX = 0;
+    var extentY = 0;
+    var layer = 0;
+    var decoded = 0;
+    for (var i = 0; i < images.length; i++) {
+        var image = images[i];
+        var buffer = source(image);
+        if (buffer instanceof DecodedImage) {
+            // Already decoded and accounted for; there is nothing to decode.
+            formats.push(null);
+            extentX = Math.max(extentX, (+image.x || 0) + buffer.width);
+            extentY = Math.max(extentY, (+image.y || 0) + buffer.height);
+            continue;
+        }
+        var info = Buffer.isBuffer(buffer) ? probe(buffer) : null;
+        formats.push(info ? info.format : 'unknown');
+        if (!info) continue;
+        extentX = Math.max(extentX, (+image.x || 0) + info.width);
+        extentY = Math.max(extentY, (+image.y || 0) + info.height);
+        layer = Math.max(layer, info.width * info.height * 4);
+        decoded += info.width * info.height * 4;
+    }
+    width = width || extentX;
+    height = height || extentY;
+    var pixels = width * height;
+    return { bytes: pixels * 4 * 2 + layer, width: width, height: height, pixels: pixels, decoded: decoded, formats: formats };
+}
+
+// Options that are reused across many calls can be validated once with
+// compileOptions(). The returned handle is frozen and can be passed to
+// blend() or Compositor#render() in place of the options object. It keeps
+// the output format and the mapnik encoding string, which the composite
+// path would otherwise build on every call; node-mapnik still parses the
+// options itself on every call.
+function CompiledOptions(options) {
+    this.metrics = !!options.metrics;
+    this.options = Object.freeze(without(options, 'metrics'));
+    this.format = outputFormat(this.options);
+    this.encoding = encodeFormat(this.options);
+    Object.freeze(this);
+}
+
+module.exports.compileOptions = function(options) {
+    if (options instanceof CompiledOptions) return options;
+    if (!options || typeof options !== 'object') throw new TypeError('options must be an object');
+    checkOptions(options);
+    return new CompiledOptions(options);
+};
+
+var FORMATS = { png: 'png', jpeg: 'jpeg', jpg: 'jpeg', webp: 'webp' };
+
+function outputFormat(options) {
+    return options && FORMATS[options.format] || 'png';
+}
+
+// The checks node-mapnik's blend() makes before it starts, with the same
+// messages. Anything else it accepts is left for it (or the encoder) to
+// report.
+function checkOptions(options) {
+    var format = options.format === undefined ? 'png' : FORMATS[options.format];
+    if (!format) throw new TypeError('Invalid output format.');
+    var quality = options.quality === undefined ? 0 : options.quality | 0;
+    if (format === 'jpeg' && (quality < 0 || quality > 100)) throw new TypeError('JPEG quality is range 0-100.');
+    if (format === 'webp' && (quality < 0 || quality > 100)) throw new TypeError('WebP quality is range 0-100.');
+    if (format === 'png' && (quality === 1 || quality > 256)) {
+        throw new TypeError('PNG images must be quantized between 2 and 256 colors.');
+    }
+    // JPEG has no compression level, and WebP's is the encoder's method
+    // (0-6). miniz has one more level than zlib.
+    if (options.compression !== undefined && format !== 'jpeg') {
+        var max = format === 'webp' ? 6 : options.encoder === 'miniz' ? 10 : 9;
+        var compression = options.compression | 0;
+        if (compression < 0 || compression > max) {
+            throw new TypeError('Compression level must be between 0 and ' + max + '.');
+        }
+    }
+    // 0 picks the size from the images.
+    ['width', 'height'].forEach(function(key) {
+        if ((options[key] | 0) < 0) throw new TypeError('Image dimensions must be greater than 0.');
+    });
+}
+
+// node-mapnik's blend has no per-image opacity or composite operation and
+// only takes encoded images, so calls that use `opacity`, `compOp` or
+// decoded images are composited with mapnik.Image instead: the layers are
+// decoded in parallel on the threadpool, composited in order onto one
+// canvas and encoded once.
+function needsComposite(images) {
+    if (!Array.isArray(images)) return false;
+    var found = false;
+    for (var i = 0; i < images.length; i++) {
+        var image = images[i];
+        var src = source(image);
+        if (src instanceof DecodedImage) {
+            if (image.tint) throw new TypeError('tint cannot be used with decoded images');
+            found = true;
+        } else if (!Buffer.isBuffer(src)) {
+            // Let node-mapnik report invalid elements.
+            return false;
+        }
+        if (image === src) continue;
+        if (image.opacity === undefined && image.compOp === undefined) continue;
+        if (image.opacity !== undefined &&
+            (typeof image.opacity !== 'number' || !(image.opacity >= 0 && image.opacity <= 1))) {
+            throw new TypeError('opacity must be a number between 0 and 1');
+        }
+        if (image.compOp !== undefined && compOp(image.compOp) === undefined) {
+            throw new TypeError("Unknown compOp '" + image.compOp + "'");
+        }
+        found = true;
+    }
+    return found;
+}
+
+// The pixels of decoded images in a call, by index, taken when blend() is
+// called so that releasing a handle afterwards doesn't affect the call,
+// even while it reads files or waits for memory. null if there are none.
+function pinDecoded(images) {
+    if (!Array.isArray(images)) return null;
+    var pinned = null;
+    for (var i = 0; i < images.length; i++) {
+        var src = source(images[i]);
+        if (!(src instanceof DecodedImage)) continue;
+        if (!src.image) throw new Error('Image handle has been released');
+        pinned = pinned || new Array(images.length);
+        pinned[i] = src.image;
+    }
+    return pinned;
+}
+
+// The encoded buffer or decoded image of an element of blend()'s first
+// argument.
+function source(image) {
+    return Buffer.isBuffer(image) || image instanceof DecodedImage ? image : image && image.buffer;
+}
+
+// Accepts mapnik's names with dashes or underscores, e.g. `dst-in`.
+function compOp(name) {
+    if (typeof name !== 'string') return undefined;
+    var ops = mapnik.compositeOp || {};
+    var key = name.replace(/-/g, '_');
+    return ops.hasOwnProperty(key) ? ops[key] : undefined;
+}
+
+function composite(job, callback) {
+    var images = job.images;
+    var options = job.options || {};
+    var layers = new Array(images.length);
+    var remaining = images.length;
+    var failed = null;
+    images.forEach(function(image, i) {
+        // Buffers have no tint, so this only tints image objects.
+        var src = job.pinned && job.pinned[i] || source(image);
+        decodeLayer({ buffer: src, tint: image.tint }, function(err, layer) {
+            if (err) failed = failed || err;
+            layers[i] = layer;
+            if (--remaining) return;
+            if (failed) return callback(failed);
+            createCanvas(job.plan.width, job.plan.height, options.matte, function(err, canvas) {
+                if (err) return callback(err);
+                compositeLayers(canvas, images, layers, function(err) {
+                    if (err) return callback(err);
+                    encode(canvas, job.encoding || encodeFormat(options), options.palette, callback);
+                });
+            });
+        });
+    });
+}
+
+// Returns a premultiplied canvas, filled with the matte color if given.
+function createCanvas(width, height, matte, callback) {
+    var canvas, color;
+    try {
+        canvas = new mapnik.Image(width, height, { premultiplied: !matte });
+        if (matte) color = new mapnik.Color(matte.charAt(0) === '#' ? matte : '#' + matte);
+    } catch (err) {
+        return callback(err);
+    }
+    if (!matte) return callback(null, canvas);
+    canvas.fill(color, function(err) {
+        if (err) return callback(err);
+        canvas.premultiply(callback);
+    });
+}
+
+// Returns a premultiplied image for an encoded buffer, a decoded image or
+// the pixels of one.
+function loadLayer(src, callback) {
+    if (src instanceof mapnik.Image) {
+        return process.nextTick(function() { callback(null, src); });
+    }
+    if (src instanceof DecodedImage) {
+        var image = src.image;
+        return process.nextTick(function() {
+            callback(image ? null : new Error('Image handle has been released'), image);
+        });
+    }
+    mapnik.Image.fromBytes(src, function(err, image) {
+        if (err) return callback(err);
+        image.premultiply(callback);
+    });
+}
+
+function compositeLayers(canvas, images, layers, callback) {
+    (function next(i) {
+        if (i >= layers.length) return callback(null, canvas);
+        var image = images[i] === source(images[i]) ? {} : images[i];
+        canvas.composite(layers[i], compositeOptions(image, 0, 0), function(err) {
+            // Let the decoded layer go as soon as it is on the canvas.
+            layers[i] = null;
+            if (err) return callback(err);
+            next(i + 1);
+        });
+    })(0);
+}
+
+// `encoding` is a mapnik format string from encodeFormat().
+function encode(canvas, encoding, palette, callback) {
+    canvas.demultiply(function(err, image) {
+        if (err) return callback(err);
+        try {
+            if (palette) image.encode(encoding, { palette: palette }, callback);
+            else image.encode(encoding, callback);
+        } catch (err) {
+            callback(err);
+        }
+    });
+}
+
+// The mapnik format string for blend()'s format, quality, mode, compression
+// and encoder options.
+function encodeFormat(options) {
+    var format = outputFormat(options);
+    var quality = options.quality | 0;
+    if (format === 'jpeg') return 'jpeg' + (quality || 80);
+    if (format === 'webp') {
+        var webp = 'webp:quality=' + (quality || 80);
+        return options.compression === undefined ? webp : webp + ':method=' + (options.compression | 0);
+    }
+    var parts = [quality || options.palette ? 'png8' : 'png32'];
+    if (quality) parts.push('c=' + quality);
+    if (options.mode) parts.push('m=' + options.mode.charAt(0));
+    if (options.compression !== undefined) parts.push('z=' + options.compression);
+    if (options.encoder === 'miniz') parts.push('e=miniz');
+    return parts.join(':');
+}
+
+// Options for mapnik.Image#composite for a layer, relative to a canvas
+// whose top left corner is at (x0, y0).
+function compositeOptions(image, x0, y0) {
+    return {
+        comp_op: image.compOp === undefined ? mapnik.compositeOp.src_over : compOp(image.compOp),
+        opacity: image.opacity === undefined ? 1 : image.opacity,
+        dx: (image.x | 0) - x0,
+        dy: (image.y | 0) - y0
+    };
+}
+
+// Decodes an image once so it can be used as a layer by many blend() calls
+// and Compositors without decoding it again. The handle can be passed
+// anywhere blend() accepts a buffer. Its pixels are premultiplied up front
+// and never modified, so concurrent jobs can share it. release() drops the
+// handle's reference to the pixels; calls made before keep theirs.
+module.exports.decode = function(buffer, callback) {
+    if (!Buffer.isBuffer(buffer)) throw new TypeError('buffer must be a Buffer');
+    if (typeof callback !== 'function') throw new TypeError('Callback required');
+    var info = probe(buffer);
+    loadLayer(buffer, function(err, image) {
+        if (err) return callback(err);
+        callback(null, new DecodedImage(image, info ? info.hasAlpha : true));
+    });
+};
+
+function DecodedImage(image, hasAlpha) {
+    Object.defineProperty(this, 'width', { value: image.width(), enumerable: true });
+    Object.defineProperty(this, 'height', { value: image.height(), enumerable: true });
+    Object.defineProperty(this, 'hasAlpha', { value: hasAlpha, enumerable: true });
+    Object.defineProperty(this, 'bytes', { value: image.width() * image.height() * 4, enumerable: true });
+    Object.defineProperty(this, 'image', { value: image, writable: true });
+    memory.decodedImages++;
+    memory.decodedBytes += this.bytes;
+}
+
+DecodedImage.prototype.release = function() {
+    if (!this.image) return;
+    this.image = null;
+    memory.decodedImages--;
+    memory.decodedBytes -= this.bytes;
+};
+
+// Keeps decoded layers and their composite between renders, for previews
+// that change one layer at a time. Layers live in numbered slots, drawn in
+// ascending order. A render only recomposites the area covered by changed
+// layers, starting from a cached composite of the layers below the lowest
+// change, and returns the previous encoding if nothing changed. Layers
+// outside the changed area aren't drawn at all.
+function Compositor(options) {
+    if (!(this instanceof Compositor)) throw new TypeError('Use new blend.Compositor()');
+    if (!options || !(options.width > 0) || !(options.height > 0)) {
+        throw new TypeError('width and height must be greater than 0');
+    }
+    this.width = options.width | 0;
+    this.height = options.height | 0;
+    this.layers = [];
+    // The last layer set for each slot, which may still be decoding.
+    this.requested = [];
+    this.canvas = null;
+    this.dirty = { x0: 0, y0: 0, x1: this.width, y1: this.height };
+    this.dirtyFrom = 0;
+    this.below = null;
+    this.encoded = null;
+    this.versions = [];
+    this.renders = [];
+}
+module.exports.Compositor = Compositor;
+
+// Sets slot `index` to a layer `{ buffer, x, y, opacity, compOp, tint }`, or
+// clears it with `null`. The layer is decoded (and tinted) on the threadpool
+// before it takes effect.
+Compositor.prototype.setLayer = function(index, layer, callback) {
+    if (!(index >= 0) || index % 1) throw new TypeError('index must be an integer >= 0');
+    if (typeof callback !== 'function') throw new TypeError('Callback required');
+    if (layer !== null) {
+        if (!layer || !(Buffer.isBuffer(layer.buffer) || layer.buffer instanceof DecodedImage)) {
+            throw new TypeError("layer must be an object with a 'buffer' property");
+        }
+        if (layer.buffer instanceof DecodedImage) {
+            if (!layer.buffer.image) throw new Error('Image handle has been released');
+            if (layer.tint) throw new TypeError('tint cannot be used with decoded images');
+        }
+        if (layer.opacity !== undefined &&
+            (typeof layer.opacity !== 'number' || !(layer.opacity >= 0 && layer.opacity <= 1))) {
+            throw new TypeError('opacity must be a number between 0 and 1');
+        }
+        if (layer.compOp !== undefined && compOp(layer.compOp) === undefined) {
+            throw new TypeError("Unknown compOp '" + layer.compOp + "'");
+        }
+    }
+    var self = this;
+    var version = this.versions[index] = (this.versions[index] || 0) + 1;
+    if (layer === null) {
+        this.requested[index] = null;
+        this.replace(index, null);
+        return process.nextTick(callback);
+    }
+    var spec = {};
+    for (var key in layer) spec[key] = layer[key];
+    this.requested[index] = spec;
+
+    var current = this.layers[index];
+    if (current && current.spec.buffer === spec.buffer &&
+        JSON.stringify(current.spec.tint) === JSON.stringify(spec.tint)) {
+        // Only the placement or blending changed; keep the decoded pixels.
+        this.replace(index, { spec: spec, image: current.image });
+        return process.nextTick(callback);
+    }
+    decodeLayer(spec, function(err, image) {
+        if (err) return callback(err);
+        // A later setLayer() for the same slot wins.
+        if (self.versions[index] === version) self.replace(index, { spec: spec, image: image });
+        callback(null);
+    });
+};
+
+// Changes some properties of the layer in slot `index`, e.g. `{ x: 10 }` or
+// `{ tint: ... }`, starting from the last layer set for the slot even if it
+// is still decoding. Only a new buffer or tint decodes again.
+Compositor.prototype.updateLayer = function(index, changes, callback) {
+    var current = this.requested[index];
+    if (!current) throw new Error('No layer at index ' + index);
+    var spec = {};
+    for (var key in current) spec[key] = current[key];
+    for (key in changes) spec[key] = changes[key];
+    this.setLayer(index, spec, callback);
+};
+
+Compositor.prototype.replace = function(index, entry) {
+    var area = union(this.bounds(this.layers[index]), this.bounds(entry));
+    this.layers[index] = entry;
+    if (!area) return;
+    this.dirty = union(this.dirty, area);
+    this.dirtyFrom = Math.min(this.dirtyFrom, index);
+};
+
+// The area of the canvas a layer covers, or null.
+Compositor.prototype.bounds = function(entry) {
+    if (!entry) return null;
+    var x = entry.spec.x | 0, y = entry.spec.y | 0;
+    var area = {
+        x0: Math.max(0, x),
+        y0: Math.max(0, y),
+        x1: Math.min(this.width, x + entry.image.width()),
+        y1: Math.min(this.height, y + entry.image.height())
+    };
+    return area.x0 < area.x1 && area.y0 < area.y1 ? area : null;
+};
+
+// Encodes the composite with blend()'s output options (`format`, `quality`,
+// `mode`, `compression`, `encoder`, `palette`). Renders run one at a time.
+Compositor.prototype.render = function(options, callback) {
+    if (typeof options === 'function') {
+        callback = options;
+        options = undefined;
+    }
+    if (typeof callback !== 'function') throw new TypeError('Callback required');
+    options = options || {};
+    var encoding;
+    if (options instanceof CompiledOptions) {
+        encoding = options.encoding;
+        options = options.options;
+    } else {
+        checkOptions(options);
+        encoding = encodeFormat(options);
+    }
+    this.renders.push({ options: options, encoding: encoding, callback: callback });
+    if (this.renders.length === 1) this.renderNext();
+};
+
+Compositor.prototype.renderNext = function() {
+    var self = this;
+    var render = this.renders[0];
+    function done(err, data) {
+        self.renders.shift();
+        if (self.renders.length) self.renderNext();
+        render.callback(err, data);
+    }
+    if (!this.dirty && this.encoded && sameOptions(this.encoded.options, render.options)) {
+        var data = this.encoded.data;
+        return process.nextTick(function() { done(null, data); });
+    }
+    var area = this.dirty;
+    var from = this.dirtyFrom;
+    var layers = this.layers.slice();
+    this.dirty = null;
+    this.dirtyFrom = Infinity;
+    // The canvas is about to change, so the last encoding is stale even if
+    // encoding the new one fails.
+    this.encoded = null;
+    this.recomposite(layers, from, area, function(err) {
+        if (err) {
+            self.dirty = { x0: 0, y0: 0, x1: self.width, y1: self.height };
+            self.dirtyFrom = 0;
+            return done(err);
+        }
+        // Encoding demultiplies in place, so encode a copy of the canvas.
+        copyImage(self.canvas, function(err, copy) {
+            if (err) return done(err);
+            encode(copy, render.encoding, render.options.palette, function(err, data) {
+                if (err) return done(err);
+                self.encoded = { options: render.options, data: data };
+                done(null, data);
+            });
+        });
+    });
+};
+
+// Redraws `area` of the canvas from the composite of the layers below
+// `from` and the layers from `from` up.
+Compositor.prototype.recomposite = function(layers, from, area, callback) {
+    var self = this;
+    if (!this.canvas) this.canvas = new mapnik.Image(this.width, this.height, { premultiplied: true });
+    if (!area) return callback(null);
+    this.snapshot(layers, from, area, function(err, below) {
+        if (err) return callback(err);
+        var region = new mapnik.Image(area.x1 - area.x0, area.y1 - area.y0, { premultiplied: true });
+        region.composite(below, { comp_op: mapnik.compositeOp.src, dx: -area.x0, dy: -area.y0 }, function(err) {
+            if (err) return callback(err);
+            compositeRange(region, layers, from, area.x0, area.y0, function(err) {
+                if (err) return callback(err);
+                self.canvas.composite(region, { comp_op: mapnik.compositeOp.src, dx: area.x0, dy: area.y0 }, callback);
+            });
+        });
+    });
+};
+
+// The composite of the layers below `index`, at least over `area`. It is
+// only drawn where a render needs it, and cached for as long as those layers
+// stay the same; the `valid` part grows as later renders need more of it.
+Compositor.prototype.snapshot = function(layers, index, area, callback) {
+    var below = this.below;
+    var same = below && below.index === index && below.layers.length === Math.min(index, layers.length) &&
+        below.layers.every(function(entry, i) { return entry === layers[i]; });
+    if (same && contains(below.valid, area)) return callback(null, below.image);
+    var self = this;
+    var image = same ? below.image : new mapnik.Image(this.width, this.height, { premultiplied: true });
+    var valid = same ? union(below.valid, area) : area;
+    var prefix = layers.slice(0, index);
+    var region = new mapnik.Image(valid.x1 - valid.x0, valid.y1 - valid.y0, { premultiplied: true });
+    compositeRange(region, prefix, 0, valid.x0, valid.y0, function(err) {
+        if (err) return callback(err);
+        image.composite(region, { comp_op: mapnik.compositeOp.src, dx: valid.x0, dy: valid.y0 }, function(err) {
+            if (err) return callback(err);
+            self.below = { index: index, layers: prefix, image: image, valid: valid };
+            callback(null, image);
+        });
+    });
+};
+
+// Composites layers from `from` up onto `canvas`, whose top left corner is
+// at (x0, y0). Layers that miss the canvas are skipped.
+function compositeRange(canvas, layers, from, x0, y0, callback) {
+    var x1 = x0 + canvas.width(), y1 = y0 + canvas.height();
+    function misses(entry) {
+        var x = entry.spec.x | 0, y = entry.spec.y | 0;
+        return x >= x1 || y >= y1 || x + entry.image.width() <= x0 || y + entry.image.height() <= y0;
+    }
+    (function next(i) {
+        while (i < layers.length && (!layers[i] || misses(layers[i]))) i++;
+        if (i >= layers.length) return callback(null);
+        canvas.composite(layers[i].image, compositeOptions(layers[i].spec, x0, y0), function(err) {
+            if (err) return callback(err);
+            next(i + 1);
+        });
+    })(from);
+}
+
+// Decodes a layer to a premultiplied image. Tints are applied by
+// node-mapnik's blend, which is the only implementation of them, into a
+// lossless PNG.
+function decodeLayer(spec, callback) {
+    if (!spec.tint) return loadLayer(spec.buffer, callback);
+    try {
+        mapnik.blend([{ buffer: spec.buffer, tint: spec.tint }], { format: 'png', reencode: true }, function(err, buffer) {
+            if (err) return callback(err);
+            loadLayer(buffer, callback);
+        });
+    } catch (err) {
+        process.nextTick(function() { callback(err); });
+    }
+}
+
+function copyImage(image, callback) {
+    var copy = new mapnik.Image(image.width(), image.height(), { premultiplied: true });
+    copy.composite(image, { comp_op: mapnik.compositeOp.src }, function(err) {
+        callback(err, copy);
+    });
+}
+
+function contains(a, b) {
+    return a.x0 <= b.x0 && a.y0 <= b.y0 && a.x1 >= b.x1 && a.y1 >= b.y1;
+}
+
+function union(a, b) {
+    if (!a) return b;
+    if (!b) return a;
+    return {
+        x0: Math.min(a.x0, b.x0),
+        y0: Math.min(a.y0, b.y0),
+        x1: Math.max(a.x1, b.x1),
+        y1: Math.max(a.y1, b.y1)
+    };
+}
+
+function sameOptions(a, b) {
+    var keys = Object.keys(a);
+    if (keys.length !== Object.keys(b).length) return false;
+    return keys.every(function(key) { return a[key] === b[key]; });
+}
+
+// Process-wide counters. All bookkeeping happens on the main thread when a
+// job calls back, so it is cheap enough to leave on.
+var LATENCY_BOUNDS = [1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192];
+var stats = createStats();
+
+function createStats() {
+    var counts = [];
+    for (var i = 0; i <= LATENCY_BOUNDS.length; i++) counts.push(0);
+    return {
+        jobs: 0,
+        errors: 0,
+        passthrough: 0,
+        pixels: 0,
+        decoded: { png: 0, jpeg: 0, webp: 0, unknown: 0 },
+        encoded: { png: 0, jpeg: 0, webp: 0 },
+        tintCache: { hits: 0, misses: 0 },
+        latency: { bounds: LATENCY_BOUNDS.slice(), counts: counts, sum: 0, max: 0 }
+    };
+}
+
+function record(job, err, data, total) {
+    stats.jobs++;
+    var ms = total / 1000;
+    var latency = stats.latency;
+    var bucket = 0;
+    while (bucket < LATENCY_BOUNDS.length && ms > LATENCY_BOUNDS[bucket]) bucket++;
+    latency.counts[bucket]++;
+    latency.sum += ms;
+    if (ms > latency.max) latency.max = ms;
+
+    if (err) {
+        stats.errors++;
+        return;
+    }
+    if (isPassthrough(job, data)) {
+        stats.passthrough++;
+        return;
+    }
+    var formats = job.plan.formats;
+    for (var i = 0; i < formats.length; i++) {
+        if (formats[i]) stats.decoded[formats[i]]++;
+    }
+    stats.encoded[job.format]++;
+    stats.pixels += job.plan.pixels;
+}
+
+// node-mapnik hands back a single input as is when it doesn't have to
+// reencode it: no reencode or matte, no tint or offset, the input's own
+// size and format. The result has the input's bytes, but not necessarily
+// the same Buffer object, so this is decided from the job.
+function isPassthrough(job, data) {
+    var images = job.images;
+    if (!Array.isArray(images) || images.length !== 1 || job.composite) return false;
+    var options = job.options || {};
+    if (options.reencode || options.matte) return false;
+    var image = images[0];
+    var buffer = source(image);
+    if (!Buffer.isBuffer(buffer) || !data || data.length !== buffer.length) return false;
+    if (image !== buffer && (image.tint || +image.x || +image.y)) return false;
+    var info = probe(buffer);
+    if (!info) return false;
+    if ((options.width > 0 && options.width !== info.width) || (options.height > 0 && options.height !== info.height)) return false;
+    return job.format === info.format;
+}
+
+module.exports.stats = function() {
+    return JSON.parse(JSON.stringify(stats));
+};
+
+module.exports.resetStats = function() {
+    stats = createStats();
+};
+
+// Workload capture. Sampled calls are appended to `calls.jsonl` in the
+// recording directory, one JSON object per line, and their input buffers are
+// stored once under `buffers/<sha1>`. benchmark/replay.js plays them back.
+var recorder = null;
+
+module.exports.startRecording = function(options) {
+    if (!options || typeof options.dir !== 'string') throw new TypeError('options.dir must be a string');
+    var sampleRate = options.sampleRate === undefined ? 1 : options.sampleRate;
+    if (typeof sampleRate !== 'number' || sampleRate < 0 || sampleRate > 1) {
+        throw new TypeError('sampleRate must be a number between 0 and 1');
+    }
+    if (recorder) throw new Error('Already recording to ' + recorder.dir);
+    mkdir(options.dir);
+    mkdir(path.join(options.dir, 'buffers'));
+    var rec = recorder = {
+        dir: options.dir,
+        sampleRate: sampleRate,
+        started: Date.now(),
+        stream: fs.createWriteStream(path.join(options.dir, 'calls.jsonl'), { flags: 'a' }),
+        stored: {},
+        writes: 0,
+        closed: false,
+        ending: false,
+        failed: false,
+        error: null,
+        onIdle: null
+    };
+    // A failed log stops the recording; the error goes to stopRecording().
+    rec.stream.on('error', function(err) {
+        rec.error = rec.error || err;
+        rec.failed = rec.closed = true;
+        if (rec.ending) ended(rec);
+    });
+    rec.stream.on('finish', function() {
+        if (rec.ending) ended(rec);
+    });
+};
+
+// Stops recording and calls back once everything has been written, with the
+// first error hit while writing the log or the buffers. Calls still in
+// flight are not recorded.
+module.exports.stopRecording = function(callback) {
+    var current = recorder;
+    recorder = null;
+    if (!current) return callback && process.nextTick(callback);
+    current.closed = true;
+    current.writes++;
+    current.onIdle = callback || null;
+    // A stream that failed won't finish.
+    if (current.failed) return process.nextTick(function() { written(current); });
+    current.ending = true;
+    current.stream.end();
+};
+
+function mkdir(dir) {
+    try {
+        fs.mkdirSync(dir);
+    } catch (err) {
+        if (err.code !== 'EEXIST') throw err;
+    }
+}
+
+function ended(rec) {
+    rec.ending = false;
+    written(rec);
+}
+
+function written(rec) {
+    if (--rec.writes === 0 && rec.onIdle) rec.onIdle(rec.error);
+}
+
+function store(rec, buffer) {
+    var hash = crypto.createHash('sha1').update(buffer).digest('hex');
+    if (!rec.stored[hash]) {
+        rec.stored[hash] = true;
+        rec.writes++;
+        // Files from an earlier session in the same directory are reused.
+        fs.writeFile(path.join(rec.dir, 'buffers', hash), buffer, { flag: 'wx' }, function(err) {
+            if (err && err.code !== 'EEXIST') rec.error = rec.error || err;
+            written(rec);
+        });
+    }
+    return hash;
+}
+
+function capture(job, err, data, total) {
+    var rec = job.recorder;
+    if (rec.closed || !Array.isArray(job.images)) return;
+    // Decoded images have no encoded form to store for replay.
+    if (job.images.some(function(image) { return source(image) instanceof DecodedImage; })) return;
+    var images = job.images.map(function(image) {
+        if (Buffer.isBuffer(image)) return { buffer: store(rec, image) };
+        var entry = {};
+        for (var key in image) entry[key] = key === 'buffer' ? store(rec, image.buffer) : image[key];
+        return entry;
+    });
+    var options;
+    if (job.options) {
+        options = {};
+        for (var key in job.options) {
+            var value = job.options[key];
+            // Palettes are native objects; keep their colors instead.
+            options[key] = key === 'palette' && value && value.toBuffer ? { rgba: value.toBuffer().toString('hex') } : value;
+        }
+    }
+    var time = Math.max(0, Date.now() - Math.round(total / 1000) - rec.started);
+    rec.stream.write(JSON.stringify({
+        time: time,
+        images: images,
+        options: options,
+        error: err ? err.message : null,
+        bytesOut: data ? data.length : 0,
+        total: total
+    }) + '\n');
+}
+
+// Compares two images pixel by pixel. Inputs can be encoded PNG/JPEG/WebP
+// buffers, which are decoded on the threadpool, mapnik.Image objects, or raw
+// unpremultiplied RGBA pixels as `{ buffer, width, height }`.
+module.exports.compare = function(a, b, options, callback) {
+    if (typeof options === 'function') {
+        callback = options;
+        options = undefined;
+    }
+    if (typeof callback !== 'function') throw new TypeError('Callback required');
+    options = options || {};
+    if (!isImageInput(a) || !isImageInput(b)) {
+        throw new TypeError('Images must be Buffers, mapnik.Image objects or { buffer, width, height } objects');
+    }
+    var metric = options.metric || 'count';
+    if (metric !== 'count' && metric !== 'psnr' && metric !== 'ssim') {
+        throw new TypeError("metric must be 'count', 'psnr' or 'ssim'");
+    }
+    var threshold = options.threshold === undefined ? 16 : options.threshold;
+    if (typeof threshold !== 'number' || threshold < 0 || threshold > 255) {
+        throw new TypeError('threshold must be a number between 0 and 255');
+    }
+    var limit = options.limit === undefined ? Infinity : options.limit;
+    if (typeof limit !== 'number' || limit < 0) throw new TypeError('limit must be a number >= 0');
+
+    var images = [];
+    var remaining = 2;
+    var failed = false;
+    [a, b].forEach(function(input, i) {
+        readPixels(input, function(err, image) {
+            if (failed) return;
+            if (err) {
+                failed = true;
+                return callback(err);
+            }
+            images[i] = image;
+            if (--remaining) return;
+            if (images[0].width !== images[1].width || images[0].height !== images[1].height) {
+                return callback(new Error('Images must have the same dimensions: ' +
+                    images[0].width + 'x' + images[0].height + ' vs. ' + images[1].width + 'x' + images[1].height));
+            }
+            var result;
+            if (metric === 'psnr') result = psnr(images[0], images[1]);
+            else if (metric === 'ssim') result = ssim(images[0], images[1]);
+            else result = countDifferences(images[0], images[1], threshold, limit);
+            callback(null, result);
+        });
+    });
+};
+
+function isImageInput(input) {
+    if (Buffer.isBuffer(input) || input instanceof mapnik.Image) return true;
+    return !!input && Buffer.isBuffer(input.buffer) && input.width > 0 && input.height > 0;
+}
+
+function readPixels(input, callback) {
+    if (Buffer.isBuffer(input)) {
+        return mapnik.Image.fromBytes(input, function(err, image) {
+            if (err) return callback(err);
+            callback(null, { data: image.data(), width: image.width(), height: image.height(), image: image });
+        });
+    }
+    var image = input instanceof mapnik.Image ? input : null;
+    var width = image ? image.width() : input.width;
+    var height = image ? image.height() : input.height;
+    var data = image ? image.data() : input.buffer;
+    process.nextTick(function() {
+        if (data.length !== width * height * 4) {
+            return callback(new Error('Raw image buffer must be width * height * 4 bytes'));
+        }
+        callback(null, { data: data, width: width, height: height, image: image });
+    });
+}
+
+// Pixels where any channel, including alpha, differs by more than
+// `threshold`, the same rule as mapnik.Image#compare. Stops counting once
+// `limit` is reached.
+function countDifferences(a, b, threshold, limit) {
+    if (limit === Infinity && a.image && b.image) {
+        return a.image.compare(b.image, { threshold: threshold, alpha: true });
+    }
+    var x = a.data, y = b.data;
+    var count = 0;
+    if (limit === 0) return count;
+    for (var i = 0; i < x.length; i += 4) {
+        if (Math.abs(x[i] - y[i]) > threshold ||
+            Math.abs(x[i + 1] - y[i + 1]) > threshold ||
+            Math.abs(x[i + 2] - y[i + 2]) > threshold ||
+            Math.abs(x[i + 3] - y[i + 3]) > threshold) {
+            if (++count >= limit) break;
+        }
+    }
+    return count;
+}
+
+// Peak signal-to-noise ratio over all four channels in dB; Infinity for
+// identical images.
+function psnr(a, b) {
+    var x = a.data, y = b.data;
+    var sum = 0;
+    for (var i = 0; i < x.length; i++) {
+        var d = x[i] - y[i];
+        sum += d * d;
+    }
+    if (!sum) return Infinity;
+    return 10 * Math.log(255 * 255 / (sum / x.length)) / Math.LN10;
+}
+
+// Mean structural similarity of the luma channel (composited onto black)
+// over 8x8 windows; 1 for identical images.
+function ssim(a, b) {
+    var width = a.width, height = a.height;
+    var la = luma(a.data), lb = luma(b.data);
+    var size = Math.min(8, width, height);
+    var c1 = (0.01 * 255) * (0.01 * 255);
+    var c2 = (0.03 * 255) * (0.03 * 255);
+    var total = 0, windows = 0;
+    for (var y0 = 0; y0 + size <= height; y0 += size) {
+        for (var x0 = 0; x0 + size <= width; x0 += size) {
+            var sa = 0, sb = 0, saa = 0, sbb = 0, sab = 0;
+            for (var y = y0; y < y0 + size; y++) {
+                for (var x = x0; x < x0 + size; x++) {
+                    var p = la[y * width + x], q = lb[y * width + x];
+                    sa += p; sb += q; saa += p * p; sbb += q * q; sab += p * q;
+                }
+            }
+            var n = size * size;
+            var ma = sa / n, mb = sb / n;
+            var va = saa / n - ma * ma, vb = sbb / n - mb * mb, cov = sab / n - ma * mb;
+            total += ((2 * ma * mb + c1) * (2 * cov + c2)) / ((ma * ma + mb * mb + c1) * (va + vb + c2));
+            windows++;
+        }
+    }
+    return total / windows;
+}
+
+function luma(data) {
+    var result = new Float32Array(data.length / 4);
+    for (var i = 0, o = 0; i < result.length; i++, o += 4) {
+        result[i] = (0.299 * data[o] + 0.587 * data[o + 1] + 0.114 * data[o + 2]) * data[o + 3] / 255;
+    }
+    return result;
+}
+
+// Hashes the pixels of an image, so the same pixels hash the same no matter
+// how they were encoded. Accepts the same inputs as blend.compare().
+// - `exact-pixels` (default): SHA-1 of the dimensions and RGBA pixels, with
+//   the color of fully transparent pixels ignored.
+// - `dhash`: 64-bit difference hash of a 9x8 luma thumbnail, for finding
+//   near duplicates with blend.hashDistance().
+module.exports.hash = function(input, options, callback) {
+    if (typeof options === 'function') {
+        callback = options;
+        options = undefined;
+    }
+    if (typeof callback !== 'function') throw new TypeError('Callback required');
+    if (!isImageInput(input)) {
+        throw new TypeError('Image must be a Buffer, mapnik.Image object or { buffer, width, height } object');
+    }
+    var kind = options && options.kind || 'exact-pixels';
+    if (kind !== 'exact-pixels' && kind !== 'dhash') throw new TypeError("kind must be 'exact-pixels' or 'dhash'");
+    readPixels(input, function(err, image) {
+        if (err) return callback(err);
+        callback(null, kind === 'dhash' ? dhash(image) : pixelHash(image));
+    });
+};
+
+// Number of differing bits between two dhash values.
+module.exports.hashDistance = function(a, b) {
+    if (typeof a !== 'string' || typeof b !== 'string' || a.length !== b.length) {
+        throw new TypeError('Hashes must be strings of the same length');
+    }
+    var distance = 0;
+    for (var i = 0; i < a.length; i++) {
+        var bits = parseInt(a[i], 16) ^ parseInt(b[i], 16);
+        for (; bits; bits >>= 1) distance += bits & 1;
+    }
+    return distance;
+};
+
+function pixelHash(image) {
+    var size = new Buffer(8);
+    size.writeUInt32BE(image.width, 0);
+    size.writeUInt32BE(image.height, 4);
+    var data = image.data;
+    var transparent = false;
+    for (var i = 3; i < data.length && !transparent; i += 4) {
+        transparent = data[i] === 0 && (data[i - 3] || data[i - 2] || data[i - 1]);
+    }
+    if (transparent) {
+        data = new Buffer(data);
+        for (var j = 3; j < data.length; j += 4) {
+            if (data[j] === 0) data[j - 3] = data[j - 2] = data[j - 1] = 0;
+        }
+    }
+    return crypto.createHash('sha1').update(size).update(data).digest('hex');
+}
+
+function dhash(image) {
+    var width = image.width, height = image.height;
+    var values = luma(image.data);
+    // Box-average the luma channel into a 9x8 thumbnail.
+    var thumb = [];
+    for (var ty = 0; ty < 8; ty++) {
+        var y0 = Math.floor(ty * height / 8), y1 = Math.max(y0 + 1, Math.floor((ty + 1) * height / 8));
+        for (var tx = 0; tx < 9; tx++) {
+            var x0 = Math.floor(tx * width / 9), x1 = Math.max(x0 + 1, Math.floor((tx + 1) * width / 9));
+            var sum = 0, n = 0;
+            for (var y = y0; y < y1 && y < height; y++) {
+                for (var x = x0; x < x1 && x < width; x++) {
+                    sum += values[y * width + x];
+                    n++;
+                }
+            }
+            thumb.push(n ? sum / n : 0);
+        }
+    }
+    // One bit per horizontally adjacent pair, as 16 hex digits.
+    var hex = '';
+    for (var row = 0; row < 8; row++) {
+        var nibble = 0;
+        for (var col = 0; col < 8; col++) {
+            nibble = (nibble << 1) | (thumb[row * 9 + col] < thumb[row * 9 + col + 1] ? 1 : 0);
+            if (col % 4 === 3) {
+                hex += nibble.toString(16);
+                nibble = 0;
+            }
+        }
+    }
+    return hex;
+}
+
+module.exports.memoryUsage = function() {
+    return {
+        current: memory.current,
+        peak: memory.peak,
+        limit: config.maxInFlightBytes,
+        jobs: memory.jobs,
+        queued: memory.queued,
+        waited: memory.waited,
+        rejected: memory.rejected,
+        waitTime: memory.waitTime,
+        maxWaitTime: memory.maxWaitTime,
+        decodedImages: memory.decodedImages,
+        decodedBytes: memory.decodedBytes
+    };
+};
+
+// Reads format, dimensions and whether an alpha channel is present from the
+// header of an encoded PNG, JPEG or WebP image without decoding it. Returns
+// null for anything it doesn't recognize.
+module.exports.probe = probe;
+function probe(buffer) {
+    if (buffer.length >= 26 && buffer.readUInt32BE(0) === 0x89504E47 && buffer.readUInt32BE(4) === 0x0D0A1A0A) {
+        return {
+            format: 'png',
+            width: buffer.readUInt32BE(16),
+            height: buffer.readUInt32BE(20),
+            hasAlpha: buffer[25] === 4 || buffer[25] === 6 || hasPNGChunk(buffer, 'tRNS')
+        };
+    }
+    if (buffer.length >= 4 && buffer[0] === 0xFF && buffer[1] === 0xD8) {
+        return probeJPEG(buffer);
+    }
+    if (buffer.length >= 30 && buffer.toString('ascii', 0, 4) === 'RIFF' && buffer.toString('ascii', 8, 12) === 'WEBP') {
+        return probeWebP(buffer);
+    }
+    return null;
+}
+
+function hasPNGChunk(buffer, type) {
+    var offset = 8;
+    while (offset + 8 <= buffer.length) {
+        var chunk = buffer.toString('ascii', offset + 4, offset + 8);
+        if (chunk === type) return true;
+        if (chunk === 'IDAT' || chunk === 'IEND') return false;
+        offset += 12 + buffer.readUInt32BE(offset);
+    }
+    return false;
+}
+
+function probeJPEG(buffer) {
+    var offset = 2;
+    while (offset + 9 <= buffer.length) {
+        if (buffer[offset] !== 0xFF) return null;
+        var marker = buffer[offset + 1];
+        // Fill bytes may precede a marker.
+        if (marker === 0xFF) {
+            offset++;
+            continue;
+        }
+        // SOF0-SOF15, except DHT (C4), JPG (C8) and DAC (CC).
+        if (marker >= 0xC0 && marker <= 0xCF && marker !== 0xC4 && marker !== 0xC8 && marker !== 0xCC) {
+            return {
+                format: 'jpeg',
+                width: buffer.readUInt16BE(offset + 7),
+                height: buffer.readUInt16BE(offset + 5),
+                hasAlpha: false
+            };
+        }
+        offset += 2 + buffer.readUInt16BE(offset + 2);
+    }
+    return null;
+}
+
+function probeWebP(buffer) {
+    var chunk = buffer.toString('ascii', 12, 16);
+    if (chunk === 'VP8 ') {
+        return {
+            format: 'webp',
+            width: buffer.readUInt16LE(26) & 0x3FFF,
+            height: buffer.readUInt16LE(28) & 0x3FFF,
+            hasAlpha: false
+        };
+    } else if (chunk === 'VP8L') {
+        var b0 = buffer[21], b1 = buffer[22], b2 = buffer[23], b3 = buffer[24];
+        return {
+            format: 'webp',
+            width: 1 + (((b1 & 0x3F) << 8) | b0),
+            height: 1 + (((b3 & 0x0F) << 10) | (b2 << 2) | ((b1 & 0xC0) >> 6)),
+            hasAlpha: ((b3 >> 4) & 1) === 1
+        };
+    } else if (chunk === 'VP8X') {
+        return {
+            format: 'webp',
+            width: 1 + (buffer[24] | (buffer[25] << 8) | (buffer[26] << 16)),
+            height: 1 + (buffer[27] | (buffer[28] << 8) | (buffer[29] << 16)),
+            hasAlpha: (buffer[20] & 0x10) !== 0
+        };
+    }
+    return null;
+}
+
 module.exports.Palette = mapnik.Palette;
 module.exports.rgb2hsl2 = mapnik.rgb2hsl;
 module.exports.hsl2rgb2 = mapnik.hsl2rgb;
 module.exports.rgb2hsl = mapnik.rgb2hsl;
 module.exports.hsl2rgb = mapnik.hsl2rgb;
 
+// Batch versions of rgb2hsl/hsl2rgb for typed arrays of RGB or HSL triplets.
+// They use the same formulas as mapnik's, but run the whole array in one
+// call instead of crossing into C++ for every color.
+//
+// rgb2hslArray takes 0-255 RGB values (e.g. a Uint8Array or Float32Array)
+// and fills `output` (a Float32Array by default) with h, s and l in 0-1.
+module.exports.rgb2hslArray = function(input, output) {
+    output = checkTriplets(input, output, Float32Array);
+    for (var i = 0; i < input.length; i += 3) {
+        toHSL(input[i], input[i + 1], input[i + 2], output, i);
+    }
+    return output;
+};
+
+// hsl2rgbArray takes h, s and l in 0-1 and fills `output` (a
+// Uint8ClampedArray by default) with RGB values rounded to 0-255.
+module.exports.hsl2rgbArray = function(input, output) {
+    output = checkTriplets(input, output, Uint8ClampedArray);
+    for (var i = 0; i < input.length; i += 3) {
+        var h = input[i], s = input[i + 1], l = input[i + 2];
+        var m2 = l <= 0.5 ? l * (s + 1) : l + s - l * s;
+        var m1 = l * 2 - m2;
+        output[i] = toByte(hueToRGB(m1, m2, h + 1 / 3));
+        output[i + 1] = toByte(hueToRGB(m1, m2, h));
+        output[i + 2] = toByte(hueToRGB(m1, m2, h - 1 / 3));
+    }
+    return output;
+};
+
+function checkTriplets(input, output, Type) {
+    if (!isTypedArray(input)) throw new TypeError('input must be a typed array');
+    if (input.length % 3) throw new TypeError('input length must be a multiple of 3');
+    if (output === undefined) return new Type(input.length);
+    if (!isTypedArray(output) || output.length < input.length) {
+        throw new TypeError('output must be a typed array at least as long as input');
+    }
+    return output;
+}
+
+// ArrayBuffer.isView() isn't available on Node 0.10, but every typed array
+// has BYTES_PER_ELEMENT and a plain Array doesn't.
+function isTypedArray(value) {
+    return !!value && typeof value.length === 'number' && typeof value.BYTES_PER_ELEMENT === 'number';
+}
+
+// Writes h, s and l for 0-255 RGB to `output` at `offset`. Same operations
+// as mapnik's rgb_to_hsl, so the results are identical to mapnik.rgb2hsl.
+function toHSL(red, green, blue, output, offset) {
+    var r = red / 255, g = green / 255, b = blue / 255;
+    var max = Math.max(r, g, b), min = Math.min(r, g, b);
+    var delta = max - min, gamma = max + min;
+    var h = 0, s = 0, l = gamma / 2;
+    if (delta > 0) {
+        s = l > 0.5 ? delta / (2 - gamma) : delta / gamma;
+        if (max === r && max !== g) h = (g - b) / delta + (g < b ? 6 : 0);
+        if (max === g && max !== b) h = (b - r) / delta + 2;
+        if (max === b && max !== r) h = (r - g) / delta + 4;
+        h /= 6;
+    }
+    output[offset] = h;
+    output[offset + 1] = s;
+    output[offset + 2] = l;
+    return output;
+}
+
+function hueToRGB(m1, m2, h) {
+    if (h < 0) h += 1;
+    else if (h > 1) h -= 1;
+    if (h * 6 < 1) return m1 + (m2 - m1) * h * 6;
+    if (h * 2 < 1) return m2;
+    if (h * 3 < 2) return m1 + (m2 - m1) * (2 / 3 - h) * 6;
+    return m1;
+}
+
+function toByte(value) {
+    return Math.max(0, Math.min(255, Math.round(value * 255)));
+}
+
 var Palette = module.exports.Palette;
 Palette.prototype.clone = function() {
     return new this.constructor(this.toBuffer());
@@ -19,16 +1569,84 @@ Palette.fromJSON = function(json) {
     return new Palette(new Buffer(palette, 'hex'), 'rgba');
 };
 
-module.exports.parseTintStringOld = function(str) {
+// Tint strings come from a small set of styles but are parsed on every
+// request, so each parser keeps its results in an LRU keyed by the string.
+// Cached objects are shared between callers and therefore frozen.
+var TINT_CACHE_SIZE = 1000;
+
+// Entries are kept in a plain object (Map isn't available on Node 0.10)
+// and linked from least to most recently used, so a hit can move its entry
+// to the back without searching.
+function memoizeTint(parse) {
+    var cache = Object.create(null);
+    var size = 0;
+    var head = { prev: null, next: null };
+    head.prev = head.next = head;
+
+    function unlink(entry) {
+        entry.prev.next = entry.next;
+        entry.next.prev = entry.prev;
+    }
+
+    function append(entry) {
+        entry.prev = head.prev;
+        entry.next = head;
+        head.prev.next = entry;
+        head.prev = entry;
+    }
+
+    return function(str, round) {
+        if (typeof str !== 'string') return freezeTint(parse(str, round));
+        var key = parse.length > 1 && round !== undefined ? round + ':' + str : str;
+        var entry = cache[key];
+        if (entry !== undefined) {
+            stats.tintCache.hits++;
+            unlink(entry);
+            append(entry);
+            return entry.value;
+        }
+        stats.tintCache.misses++;
+        var value = freezeTint(parse(str, round));
+        if (size >= TINT_CACHE_SIZE) {
+            var oldest = head.next;
+            unlink(oldest);
+            delete cache[oldest.key];
+            size--;
+        }
+        entry = { key: key, value: value, prev: null, next: null };
+        append(entry);
+        cache[key] = entry;
+        size++;
+        return value;
+    };
+}
+
+// Parsed tints are flat objects whose values are numbers or [min, max] pairs.
+function freezeTint(value) {
+    if (value && typeof value === 'object') {
+        for (var key in value) {
+            if (typeof value[key] === 'object') Object.freeze(value[key]);
+        }
+        Object.freeze(value);
+    }
+    return value;
+}
+
+module.exports.parseTintStringOld = memoizeTint(parseTintStringOld);
+module.exports.parseTintString = memoizeTint(parseTintString);
+module.exports.upgradeTintString = memoizeTint(upgradeTintString);
+
+function parseTintStringOld(str) {
     if (!str.length) return {};
 
     var options = {};
     var hex = str.match(/^#?([0-9a-f]{6})$/i);
     if (hex) {
-        var hsl = mapnik.rgb2hsl(
+        var hsl = toHSL(
             parseInt(hex[1].substring(0, 2), 16),
             parseInt(hex[1].substring(2, 4), 16),
-            parseInt(hex[1].substring(4, 6), 16)
+            parseInt(hex[1].substring(4, 6), 16),
+            [], 0
         );
         options.hue = hsl[0]*365;
         options.saturation = hsl[1]*100;
@@ -53,18 +1671,19 @@ module.exports.parseTintStringOld = function(str) {
     }
 
     return options;
-};
+}
 
-module.exports.parseTintString = function(str) {
+function parseTintString(str) {
     if (!str || !str.length) return {};
 
     var options = {};
     var hex = str.match(/^#?([0-9a-f]{6})$/i);
     if (hex) {
-        var hsl = mapnik.rgb2hsl(
+        var hsl = toHSL(
             parseInt(hex[1].substring(0, 2), 16),
             parseInt(hex[1].substring(2, 4), 16),
-            parseInt(hex[1].substring(4, 6), 16)
+            parseInt(hex[1].substring(4, 6), 16),
+            [], 0
         );
         options.h = [hsl[0],hsl[0]]
         options.s = [hsl[1],hsl[1]];
@@ -99,9 +1718,9 @@ module.exports.parseTintString = function(str) {
     }
 
     return options;
-};
+}
 
-module.exports.upgradeTintString = function(old,round) {
+function upgradeTintString(old,round) {
     if (!old || !old.length) return old;
     if (old.match(/^#?([0-9a-f]{6})$/i) || old.indexOf('x') !== -1) return old;
     var new_tint = '';
@@ -101,3 +101,52 @@ describe('roundtripping rgb->hsl->rgb in both js and c++', function() {
         });
     });
 });
+
+describe('batch conversion of typed arrays', function() {
+    var rgb = new Uint8Array(colors.length * 3);
+    colors.forEach(function(c, i) {
+        rgb[i * 3] = c[0];
+        rgb[i * 3 + 1] = c[1];
+        rgb[i * 3 + 2] = c[2];
+    });
+
+    it('should convert rgb to hsl', function() {
+        var hsl = blend.rgb2hslArray(rgb);
+        assert.ok(hsl instanceof Float32Array);
+        assert.equal(hsl.length, rgb.length);
+        expected.forEach(function(e, i) {
+            nearlyEqual([hsl[i * 3], hsl[i * 3 + 1], hsl[i * 3 + 2]], e, 0.001);
+        });
+    });
+
+    it('should accept floats and fill a given output', function() {
+        var output = new Float64Array(rgb.length);
+        assert.equal(blend.rgb2hslArray(new Float32Array(rgb), output), output);
+        expected.forEach(function(e, i) {
+            nearlyEqual([output[i * 3], output[i * 3 + 1], output[i * 3 + 2]], e, 0.001);
+        });
+    });
+
+    it('should roundtrip hsl to rgb', function() {
+        var back = blend.hsl2rgbArray(blend.rgb2hslArray(rgb));
+        assert.ok(back instanceof Uint8ClampedArray);
+        colors.forEach(function(c, i) {
+            nearlyEqual([back[i * 3], back[i * 3 + 1], back[i * 3 + 2]], c, 1);
+        });
+    });
+
+    it('should match the per-color methods', function() {
+        var hsl = blend.rgb2hslArray(rgb);
+        var back = blend.hsl2rgbArray(hsl);
+        colors.forEach(function(c, i) {
+            nearlyEqual([hsl[i * 3], hsl[i * 3 + 1], hsl[i * 3 + 2]], blend.rgb2hsl(c[0], c[1], c[2]), 0.001);
+            nearlyEqual([back[i * 3], back[i * 3 + 1], back[i * 3 + 2]], blend.hsl2rgb(hsl[i * 3], hsl[i * 3 + 1], hsl[i * 3 + 2]), 1);
+        });
+    });
+
+    it('should validate arguments', function() {
+        assert.throws(function() { blend.rgb2hslArray([1, 2, 3]); }, /input must be a typed array/);
+        assert.throws(function() { blend.rgb2hslArray(new Uint8Array(4)); }, /input length must be a multiple of 3/);
+        assert.throws(function() { blend.hsl2rgbArray(new Float32Array(6), new Uint8Array(3)); }, /output must be a typed array at least as long as input/);
+    });
+});
@@ -0,0 +1,120 @@
+var assert = require('assert');
+var fs = require('fs');
+
+var blend = require('..');
+
+
+function raw(width, height, rgba) {
+    var buffer = new Buffer(width * height * 4);
+    for (var i = 0; i < buffer.length; i += 4) {
+        buffer[i] = rgba[0];
+        buffer[i + 1] = rgba[1];
+        buffer[i + 2] = rgba[2];
+        buffer[i + 3] = rgba[3];
+    }
+    return { buffer: buffer, width: width, height: height };
+}
+
+describe('image comparison', function() {
+    it('should validate arguments', function() {
+        var image = raw(4, 4, [0, 0, 0, 255]);
+        assert.throws(function() { blend.compare(image, image); }, /Callback required/);
+        assert.throws(function() { blend.compare(image, 'foo', function() {}); }, /Images must be Buffers/);
+        assert.throws(function() { blend.compare(image, image, { metric: 'mse' }, function() {}); }, /metric must be/);
+        assert.throws(function() { blend.compare(image, image, { threshold: 300 }, function() {}); }, /threshold must be a number between 0 and 255/);
+        assert.throws(function() { blend.compare(image, image, { limit: -1 }, function() {}); }, /limit must be a number >= 0/);
+    });
+
+    it('should report identical raw images', function(done) {
+        var a = raw(16, 16, [10, 20, 30, 255]);
+        var b = raw(16, 16, [10, 20, 30, 255]);
+        blend.compare(a, b, function(err, count) {
+            if (err) return done(err);
+            assert.equal(count, 0);
+            blend.compare(a, b, { metric: 'psnr' }, function(err, psnr) {
+                if (err) return done(err);
+                assert.equal(psnr, Infinity);
+                blend.compare(a, b, { metric: 'ssim' }, function(err, ssim) {
+                    if (err) return done(err);
+                    assert.equal(ssim, 1);
+                    done();
+                });
+            });
+        });
+    });
+
+    it('should count pixels above the threshold', function(done) {
+        var a = raw(16, 16, [100, 100, 100, 255]);
+        var b = raw(16, 16, [100, 100, 100, 255]);
+        for (var i = 0; i < 10; i++) b.buffer[i * 4] = 110;
+        for (var j = 10; j < 30; j++) b.buffer[j * 4 + 3] = 0;
+        blend.compare(a, b, function(err, count) {
+            if (err) return done(err);
+            assert.equal(count, 20);
+            blend.compare(a, b, { threshold: 5 }, function(err, count) {
+                if (err) return done(err);
+                assert.equal(count, 30);
+                done();
+            });
+        });
+    });
+
+    it('should stop counting at the limit', function(done) {
+        var a = raw(16, 16, [0, 0, 0, 255]);
+        var b = raw(16, 16, [255, 255, 255, 255]);
+        blend.compare(a, b, { limit: 5 }, function(err, count) {
+            if (err) return done(err);
+            assert.equal(count, 5);
+            blend.compare(a, b, { limit: 0 }, function(err, count) {
+                if (err) return done(err);
+                assert.equal(count, 0);
+                done();
+            });
+        });
+    });
+
+    it('should compute psnr and ssim of different images', function(done) {
+        var a = raw(16, 16, [100, 100, 100, 255]);
+        var b = raw(16, 16, [110, 100, 100, 255]);
+        blend.compare(a, b, { metric: 'psnr' }, function(err, psnr) {
+            if (err) return done(err);
+            // MSE is 100 / 4 = 25.
+            assert.ok(Math.abs(psnr - 10 * Math.log(255 * 255 / 25) / Math.LN10) < 1e-9);
+            blend.compare(a, b, { metric: 'ssim' }, function(err, ssim) {
+                if (err) return done(err);
+                assert.ok(ssim < 1 && ssim > 0.9);
+                done();
+            });
+        });
+    });
+
+    it('should reject images of different sizes', function(done) {
+        blend.compare(raw(16, 16, [0, 0, 0, 0]), raw(8, 16, [0, 0, 0, 0]), function(err) {
+            assert.ok(err);
+            assert.equal(err.message, 'Images must have the same dimensions: 16x16 vs. 8x16');
+            done();
+        });
+    });
+
+    it('should reject raw buffers of the wrong size', function(done) {
+        var image = raw(16, 16, [0, 0, 0, 0]);
+        blend.compare(image, { buffer: image.buffer, width: 16, height: 15 }, function(err) {
+            assert.ok(err);
+            assert.equal(err.message, 'Raw image buffer must be width * height * 4 bytes');
+            done();
+        });
+    });
+
+    it('should compare encoded images', function(done) {
+        var png = fs.readFileSync('test/fixture/1.png');
+        blend.compare(png, png, function(err, count) {
+            if (err) return done(err);
+            assert.equal(count, 0);
+            blend.compare(png, fs.readFileSync('test/fixture/2.png'), { limit: 1 }, function(err, count) {
+                if (err) return done(err);
+                assert.equal(count, 1);
+                done();
+            });
+        });
+    });
+});
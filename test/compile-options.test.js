@@ -0,0 +1,65 @@
+var assert = require('assert');
+var fs = require('fs');
+
+var blend = require('..');
+
+
+var images = [
+    fs.readFileSync('test/fixture/1.png'),
+    fs.readFileSync('test/fixture/2.png')
+];
+
+describe('compiled options', function() {
+    it('should report invalid options at compile time', function() {
+        assert.throws(function() { blend.compileOptions({ format: 'xbm' }); }, /Invalid output format/);
+        assert.throws(function() { blend.compileOptions({ format: 'jpeg', quality: -10 }); }, /JPEG quality is range 0-100/);
+        assert.throws(function() { blend.compileOptions({ format: 'jpeg', quality: 110 }); }, /JPEG quality is range 0-100/);
+        assert.throws(function() { blend.compileOptions({ compression: 10 }); }, /Compression level must be between 0 and 9/);
+        assert.throws(function() { blend.compileOptions({ format: 'webp', compression: 7 }); }, /Compression level must be between 0 and 6/);
+        assert.throws(function() { blend.compileOptions({ width: -20 }); }, /Image dimensions must be greater than 0/);
+        assert.throws(function() { blend.compileOptions({ height: -20 }); }, /Image dimensions must be greater than 0/);
+        assert.throws(function() { blend.compileOptions(); }, /options must be an object/);
+    });
+
+    it('should accept what blend() accepts', function() {
+        blend.compileOptions({ width: 0, height: 0 });
+        blend.compileOptions({ format: 'jpg', quality: 0 });
+        blend.compileOptions({ format: 'jpeg', compression: 20 });
+        blend.compileOptions({ encoder: 'miniz', compression: 10 });
+    });
+
+    it('should pass webp compression on as the encoder method', function() {
+        assert.equal(blend.compileOptions({ format: 'webp', compression: 1 }).encoding, 'webp:quality=80:method=1');
+        assert.equal(blend.compileOptions({ format: 'webp', quality: 90 }).encoding, 'webp:quality=90');
+    });
+
+    it('should return a frozen handle', function() {
+        var compiled = blend.compileOptions({ format: 'png', quality: 64, width: 256, height: 256 });
+        assert.ok(Object.isFrozen(compiled));
+        assert.ok(Object.isFrozen(compiled.options));
+        assert.strictEqual(blend.compileOptions(compiled), compiled);
+    });
+
+    it('should blend like the options it was compiled from', function(done) {
+        var options = { format: 'jpeg', quality: 70, width: 256, height: 256 };
+        var compiled = blend.compileOptions(options);
+        blend(images, options, function(err, expected) {
+            if (err) return done(err);
+            blend(images, compiled, function(err, data) {
+                if (err) return done(err);
+                assert.deepEqual(data, expected);
+                done();
+            });
+        });
+    });
+
+    it('should keep the metrics option', function(done) {
+        var compiled = blend.compileOptions({ width: 256, height: 256, metrics: true });
+        assert.equal(compiled.options.metrics, undefined);
+        blend(images, compiled, function(err, data, metrics) {
+            if (err) return done(err);
+            assert.equal(metrics.layers, 2);
+            done();
+        });
+    });
+});
@@ -0,0 +1,89 @@
+var assert = require('assert');
+var fs = require('fs');
+var mapnik = require('mapnik');
+
+var blend = require('..');
+
+
+var base = fs.readFileSync('test/fixture/1.png');
+var overlay = fs.readFileSync('test/fixture/2.png');
+var options = { width: 256, height: 256 };
+
+function solid(color) {
+    var image = new mapnik.Image(256, 256);
+    image.fillSync(new mapnik.Color(color));
+    return image.encodeSync('png32');
+}
+
+function unchanged(data, done) {
+    blend.compare(data, base, function(err, count) {
+        if (err) return done(err);
+        assert.equal(count, 0);
+        done();
+    });
+}
+
+describe('per-image opacity and compOp', function() {
+    it('should validate per-image options', function() {
+        assert.throws(function() {
+            blend([ base, { buffer: overlay, compOp: 'bogus' } ], function() {});
+        }, /Unknown compOp 'bogus'/);
+        assert.throws(function() {
+            blend([ base, { buffer: overlay, opacity: 2 } ], function() {});
+        }, /opacity must be a number between 0 and 1/);
+    });
+
+    it('should tint layers of composited calls', function(done) {
+        var tint = { h: [0.5, 0.5], s: [1, 1] };
+        blend([ { buffer: base, tint: tint }, overlay ], options, function(err, expected) {
+            if (err) return done(err);
+            blend([ { buffer: base, tint: tint }, { buffer: overlay, opacity: 1 } ], options, function(err, data) {
+                if (err) return done(err);
+                blend.compare(data, expected, { threshold: 1 }, function(err, count) {
+                    if (err) return done(err);
+                    assert.equal(count, 0);
+                    done();
+                });
+            });
+        });
+    });
+
+    it('should skip a fully transparent layer', function(done) {
+        blend([ base, { buffer: overlay, opacity: 0 } ], options, function(err, data) {
+            if (err) return done(err);
+            unchanged(data, done);
+        });
+    });
+
+    it('should multiply by white without changes', function(done) {
+        blend([ base, { buffer: solid('white'), compOp: 'multiply' } ], options, function(err, data) {
+            if (err) return done(err);
+            unchanged(data, done);
+        });
+    });
+
+    it('should accept dashed operation names', function(done) {
+        blend([ base, { buffer: solid('black'), compOp: 'dst-in' } ], options, function(err, data) {
+            if (err) return done(err);
+            unchanged(data, done);
+        });
+    });
+
+    it('should apply opacity to alpha', function(done) {
+        blend([ { buffer: solid('white'), opacity: 0.5 } ], options, function(err, data) {
+            if (err) return done(err);
+            var pixels = mapnik.Image.fromBytesSync(data).data();
+            assert.ok(Math.abs(pixels[3] - 128) <= 1);
+            assert.ok(Math.abs(pixels[pixels.length - 1] - 128) <= 1);
+            done();
+        });
+    });
+
+    it('should encode in the requested format', function(done) {
+        blend([ base, { buffer: overlay, compOp: 'screen' } ], { width: 256, height: 256, format: 'jpeg' }, function(err, data) {
+            if (err) return done(err);
+            assert.equal(blend.probe(data).format, 'jpeg');
+            done();
+        });
+    });
+});
@@ -0,0 +1,125 @@
+var assert = require('assert');
+var fs = require('fs');
+
+var blend = require('..');
+
+
+var base = fs.readFileSync('test/fixture/1.png');
+var overlay = fs.readFileSync('test/fixture/2.png');
+
+// Checks a render against the same layers blended from scratch. Both are
+// 32-bit PNGs, so they may only differ by rounding.
+function matches(data, images, done) {
+    blend(images, { width: 300, height: 300 }, function(err, expected) {
+        if (err) return done(err);
+        blend.compare(data, expected, { threshold: 1 }, function(err, count) {
+            if (err) return done(err);
+            assert.equal(count, 0);
+            done();
+        });
+    });
+}
+
+describe('Compositor', function() {
+    it('should validate arguments', function() {
+        assert.throws(function() { new blend.Compositor({ width: 0, height: 10 }); }, /width and height must be greater than 0/);
+        var compositor = new blend.Compositor({ width: 10, height: 10 });
+        assert.throws(function() { compositor.setLayer(-1, { buffer: base }, function() {}); }, /index must be an integer/);
+        assert.throws(function() { compositor.setLayer(0, {}, function() {}); }, /layer must be an object with a 'buffer' property/);
+        assert.throws(function() { compositor.setLayer(0, { buffer: base, compOp: 'bogus' }, function() {}); }, /Unknown compOp/);
+        assert.throws(function() { compositor.updateLayer(3, { x: 1 }, function() {}); }, /No layer at index 3/);
+        assert.throws(function() { compositor.render({ format: 'xbm' }, function() {}); }, /Invalid output format/);
+    });
+
+    it('should render like blend() and follow updates', function(done) {
+        var compositor = new blend.Compositor({ width: 300, height: 300 });
+        compositor.setLayer(0, { buffer: base }, function(err) {
+            if (err) return done(err);
+            compositor.setLayer(1, { buffer: overlay, x: 20, y: 30 }, function(err) {
+                if (err) return done(err);
+                compositor.render(function(err, data) {
+                    if (err) return done(err);
+                    matches(data, [ base, { buffer: overlay, x: 20, y: 30 } ], function(err) {
+                        if (err) return done(err);
+                        compositor.updateLayer(1, { x: 40, y: 10 }, function(err) {
+                            if (err) return done(err);
+                            compositor.render(function(err, data) {
+                                if (err) return done(err);
+                                matches(data, [ base, { buffer: overlay, x: 40, y: 10 } ], done);
+                            });
+                        });
+                    });
+                });
+            });
+        });
+    });
+
+    it('should update a layer that is still decoding', function(done) {
+        var compositor = new blend.Compositor({ width: 300, height: 300 });
+        compositor.setLayer(0, { buffer: base }, function(err) {
+            if (err) return done(err);
+            var remaining = 2;
+            function updated(err) {
+                if (err) return done(err);
+                if (--remaining) return;
+                compositor.render(function(err, data) {
+                    if (err) return done(err);
+                    matches(data, [ { buffer: overlay, x: 5 } ], done);
+                });
+            }
+            compositor.setLayer(0, { buffer: overlay }, updated);
+            compositor.updateLayer(0, { x: 5 }, updated);
+        });
+    });
+
+    it('should reuse the last encoding when nothing changed', function(done) {
+        var compositor = new blend.Compositor({ width: 256, height: 256 });
+        compositor.setLayer(0, { buffer: base }, function(err) {
+            if (err) return done(err);
+            compositor.render(function(err, first) {
+                if (err) return done(err);
+                compositor.render(function(err, second) {
+                    if (err) return done(err);
+                    assert.strictEqual(second, first);
+                    compositor.render({ format: 'jpeg' }, function(err, third) {
+                        if (err) return done(err);
+                        assert.equal(blend.probe(third).format, 'jpeg');
+                        done();
+                    });
+                });
+            });
+        });
+    });
+
+    it('should tint like blend()', function(done) {
+        var tint = blend.parseTintString('0.5x1;0x1;0x1;0x1');
+        var compositor = new blend.Compositor({ width: 300, height: 300 });
+        compositor.setLayer(0, { buffer: overlay, tint: tint }, function(err) {
+            if (err) return done(err);
+            compositor.render(function(err, data) {
+                if (err) return done(err);
+                matches(data, [ { buffer: overlay, tint: tint } ], done);
+            });
+        });
+    });
+
+    it('should clear layers', function(done) {
+        var compositor = new blend.Compositor({ width: 300, height: 300 });
+        compositor.setLayer(0, { buffer: base }, function(err) {
+            if (err) return done(err);
+            compositor.setLayer(1, { buffer: overlay, x: 10, y: 10 }, function(err) {
+                if (err) return done(err);
+                compositor.render(function(err) {
+                    if (err) return done(err);
+                    compositor.setLayer(1, null, function(err) {
+                        if (err) return done(err);
+                        compositor.render(function(err, data) {
+                            if (err) return done(err);
+                            matches(data, [ base ], done);
+                        });
+                    });
+                });
+            });
+        });
+    });
+});
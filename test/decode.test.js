@@ -0,0 +1,113 @@
+var assert = require('assert');
+var fs = require('fs');
+
+var blend = require('..');
+
+
+var base = fs.readFileSync('test/fixture/1.png');
+var overlay = fs.readFileSync('test/fixture/2.png');
+
+describe('decoded images', function() {
+    it('should validate arguments', function() {
+        assert.throws(function() { blend.decode('foo', function() {}); }, /buffer must be a Buffer/);
+        assert.throws(function() { blend.decode(overlay); }, /Callback required/);
+    });
+
+    it('should describe the image', function(done) {
+        blend.decode(overlay, function(err, image) {
+            if (err) return done(err);
+            assert.equal(image.width, 256);
+            assert.equal(image.height, 256);
+            assert.equal(image.hasAlpha, true);
+            image.width = 10;
+            assert.equal(image.width, 256);
+            image.release();
+            done();
+        });
+    });
+
+    it('should blend like the encoded image', function(done) {
+        blend.decode(overlay, function(err, image) {
+            if (err) return done(err);
+            blend([ base, { buffer: image, x: 10, y: 10 } ], { width: 256, height: 256 }, function(err, data) {
+                if (err) return done(err);
+                blend([ base, { buffer: overlay, x: 10, y: 10 } ], { width: 256, height: 256 }, function(err, expected) {
+                    if (err) return done(err);
+                    blend.compare(data, expected, { threshold: 1 }, function(err, count) {
+                        if (err) return done(err);
+                        assert.equal(count, 0);
+                        image.release();
+                        done();
+                    });
+                });
+            });
+        });
+    });
+
+    it('should be reusable by concurrent jobs and compositors', function(done) {
+        blend.decode(overlay, function(err, image) {
+            if (err) return done(err);
+            var results = [];
+            var compositor = new blend.Compositor({ width: 256, height: 256 });
+            compositor.setLayer(0, { buffer: image }, function(err) {
+                if (err) return done(err);
+                compositor.render(collect);
+                blend([ image ], collect);
+                blend([ image ], collect);
+            });
+            function collect(err, data) {
+                if (err) return done(err);
+                results.push(data);
+                if (results.length < 3) return;
+                blend.compare(results[1], results[2], function(err, count) {
+                    if (err) return done(err);
+                    assert.equal(count, 0);
+                    image.release();
+                    done();
+                });
+            }
+        });
+    });
+
+    it('should keep working for calls made before release()', function(done) {
+        blend.decode(overlay, function(err, image) {
+            if (err) return done(err);
+            var remaining = 2;
+            function check(err, data) {
+                if (err) return done(err);
+                assert.equal(blend.probe(data).width, 256);
+                if (--remaining === 0) done();
+            }
+            blend([ image ], { width: 256, height: 256 }, check);
+            // Starts after the file has been read.
+            blend([ { path: 'test/fixture/1.png' }, image ], { width: 256, height: 256 }, check);
+            image.release();
+        });
+    });
+
+    it('should account for decoded memory until released', function(done) {
+        var before = blend.memoryUsage();
+        blend.decode(overlay, function(err, image) {
+            if (err) return done(err);
+            var during = blend.memoryUsage();
+            assert.equal(during.decodedImages, before.decodedImages + 1);
+            assert.equal(during.decodedBytes, before.decodedBytes + 256 * 256 * 4);
+            image.release();
+            image.release();
+            assert.equal(blend.memoryUsage().decodedBytes, before.decodedBytes);
+            assert.throws(function() { blend([ image ], function() {}); }, /Image handle has been released/);
+            done();
+        });
+    });
+
+    it('should not tint decoded images', function(done) {
+        blend.decode(overlay, function(err, image) {
+            if (err) return done(err);
+            assert.throws(function() {
+                blend([ { buffer: image, tint: { h: [0, 1] } } ], function() {});
+            }, /tint cannot be used with decoded images/);
+            image.release();
+            done();
+        });
+    });
+});
@@ -0,0 +1,65 @@
+var assert = require('assert');
+var fs = require('fs');
+var os = require('os');
+var path = require('path');
+
+var blend = require('..');
+
+
+var images = [
+    fs.readFileSync('test/fixture/1.png'),
+    fs.readFileSync('test/fixture/2.png')
+];
+
+describe('file inputs', function() {
+    var packed = path.join(os.tmpdir(), 'blend-file-input-' + process.pid + '.bin');
+    var fd;
+
+    before(function() {
+        // Both images back to back after a few bytes of padding, like a tile cache.
+        fs.writeFileSync(packed, Buffer.concat([ new Buffer('pad!'), images[0], images[1] ]));
+        fd = fs.openSync(packed, 'r');
+    });
+
+    after(function() {
+        fs.closeSync(fd);
+        fs.unlinkSync(packed);
+    });
+
+    it('should validate file inputs', function() {
+        assert.throws(function() { blend([ { path: '' } ], function() {}); }, /path must be a non-empty string/);
+        assert.throws(function() { blend([ { fd: -1 } ], function() {}); }, /fd must be an integer >= 0/);
+        assert.throws(function() { blend([ { fd: fd, offset: 1.5 } ], function() {}); }, /offset must be an integer >= 0/);
+    });
+
+    it('should blend files like buffers', function(done) {
+        var options = { width: 256, height: 256 };
+        blend([ { buffer: images[0] }, { buffer: images[1], x: 10 } ], options, function(err, expected) {
+            if (err) return done(err);
+            blend([
+                { path: 'test/fixture/1.png' },
+                { fd: fd, offset: 4 + images[0].length, length: images[1].length, x: 10 }
+            ], options, function(err, data) {
+                if (err) return done(err);
+                assert.deepEqual(data, expected);
+                done();
+            });
+        });
+    });
+
+    it('should read to the end of the file without a length', function(done) {
+        blend([ { fd: fd, offset: 4 + images[0].length } ], function(err, data) {
+            if (err) return done(err);
+            assert.deepEqual(data, images[1]);
+            done();
+        });
+    });
+
+    it('should pass read errors to the callback', function(done) {
+        blend([ { path: 'test/fixture/does-not-exist.png' }, images[1] ], function(err) {
+            assert.ok(err);
+            assert.equal(err.code, 'ENOENT');
+            done();
+        });
+    });
+});
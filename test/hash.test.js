@@ -0,0 +1,104 @@
+var assert = require('assert');
+var fs = require('fs');
+var mapnik = require('mapnik');
+
+var blend = require('..');
+
+
+// Horizontal gradient, so neighbouring dhash cells differ.
+function gradient(width, height, alpha) {
+    var buffer = new Buffer(width * height * 4);
+    for (var y = 0; y < height; y++) {
+        for (var x = 0; x < width; x++) {
+            var o = (y * width + x) * 4;
+            buffer[o] = buffer[o + 1] = buffer[o + 2] = Math.floor(x * 255 / width);
+            buffer[o + 3] = alpha;
+        }
+    }
+    return { buffer: buffer, width: width, height: height };
+}
+
+describe('pixel hashing', function() {
+    it('should validate arguments', function() {
+        var image = gradient(4, 4, 255);
+        assert.throws(function() { blend.hash(image); }, /Callback required/);
+        assert.throws(function() { blend.hash('foo', function() {}); }, /Image must be a Buffer/);
+        assert.throws(function() { blend.hash(image, { kind: 'md5' }, function() {}); }, /kind must be/);
+    });
+
+    it('should hash identical pixels the same', function(done) {
+        blend.hash(gradient(32, 32, 255), function(err, a) {
+            if (err) return done(err);
+            assert.ok(/^[0-9a-f]{40}$/.test(a));
+            blend.hash(gradient(32, 32, 255), { kind: 'exact-pixels' }, function(err, b) {
+                if (err) return done(err);
+                assert.equal(a, b);
+                done();
+            });
+        });
+    });
+
+    it('should ignore the color of transparent pixels', function(done) {
+        var a = gradient(32, 32, 0);
+        var b = gradient(32, 32, 0);
+        b.buffer.fill(0);
+        blend.hash(a, function(err, hashA) {
+            if (err) return done(err);
+            blend.hash(b, function(err, hashB) {
+                if (err) return done(err);
+                assert.equal(hashA, hashB);
+                // The input is left untouched.
+                assert.notEqual(a.buffer[4], 0);
+                done();
+            });
+        });
+    });
+
+    it('should include the dimensions', function(done) {
+        var image = gradient(32, 32, 255);
+        blend.hash(image, function(err, a) {
+            if (err) return done(err);
+            blend.hash({ buffer: image.buffer, width: 16, height: 64 }, function(err, b) {
+                if (err) return done(err);
+                assert.notEqual(a, b);
+                done();
+            });
+        });
+    });
+
+    it('should compute a dhash that tolerates small changes', function(done) {
+        var a = gradient(64, 64, 255);
+        var b = gradient(64, 64, 255);
+        b.buffer[0] = 200;
+        blend.hash(a, { kind: 'dhash' }, function(err, hashA) {
+            if (err) return done(err);
+            assert.equal(hashA, 'ffffffffffffffff');
+            blend.hash(b, { kind: 'dhash' }, function(err, hashB) {
+                if (err) return done(err);
+                assert.ok(blend.hashDistance(hashA, hashB) <= 1);
+                done();
+            });
+        });
+    });
+
+    it('should count differing bits', function() {
+        assert.equal(blend.hashDistance('0000000000000000', '0000000000000000'), 0);
+        assert.equal(blend.hashDistance('0000000000000000', 'f00000000000000f'), 8);
+        assert.throws(function() { blend.hashDistance('00', '000'); }, /Hashes must be strings of the same length/);
+    });
+
+    it('should hash a PNG and a differently encoded copy the same', function(done) {
+        var png = fs.readFileSync('test/fixture/1.png');
+        // 1.png is paletted, the copy is lossless 32 bit RGBA.
+        var reencoded = mapnik.Image.fromBytesSync(png).encodeSync('png32');
+        assert.notDeepEqual(reencoded, png);
+        blend.hash(png, function(err, a) {
+            if (err) return done(err);
+            blend.hash(reencoded, function(err, b) {
+                if (err) return done(err);
+                assert.equal(a, b);
+                done();
+            });
+        });
+    });
+});
@@ -0,0 +1,170 @@
+var assert = require('assert');
+var fs = require('fs');
+
+var blend = require('..');
+
+
+describe('probing image headers', function() {
+    it('should read PNG dimensions and alpha', function() {
+        assert.deepEqual(blend.probe(fs.readFileSync('test/fixture/pattern.png')),
+            { format: 'png', width: 20, height: 10, hasAlpha: true });
+        assert.deepEqual(blend.probe(fs.readFileSync('test/fixture/1.png')),
+            { format: 'png', width: 256, height: 256, hasAlpha: false });
+    });
+
+    it('should read JPEG dimensions', function() {
+        assert.deepEqual(blend.probe(fs.readFileSync('test/fixture/1c.jpg')),
+            { format: 'jpeg', width: 256, height: 256, hasAlpha: false });
+        assert.deepEqual(blend.probe(fs.readFileSync('test/fixture/1293.jpg')),
+            { format: 'jpeg', width: 256, height: 256, hasAlpha: false });
+    });
+
+    it('should read WebP dimensions', function() {
+        assert.deepEqual(blend.probe(fs.readFileSync('test/fixture/9.webp')),
+            { format: 'webp', width: 256, height: 256, hasAlpha: false });
+    });
+
+    it('should return null for unknown data', function() {
+        var buffer = new Buffer(1024);
+        buffer.fill(0);
+        assert.equal(blend.probe(buffer), null);
+        assert.equal(blend.probe(new Buffer(0)), null);
+    });
+});
+
+describe('native memory accounting', function() {
+    var images = [
+        fs.readFileSync('test/fixture/1.png'),
+        fs.readFileSync('test/fixture/2.png')
+    ];
+
+    it('should account for jobs in flight', function(done) {
+        var before = blend.memoryUsage();
+        blend(images, { width: 512, height: 512 }, function(err) {
+            if (err) return done(err);
+            var after = blend.memoryUsage();
+            assert.equal(after.current, before.current);
+            assert.equal(after.jobs, before.jobs);
+            assert.ok(after.peak >= 512 * 512 * 4 * 2 + 256 * 256 * 4);
+            done();
+        });
+        assert.equal(blend.memoryUsage().jobs, before.jobs + 1);
+        assert.equal(blend.memoryUsage().current, before.current + 512 * 512 * 4 * 2 + 256 * 256 * 4);
+    });
+
+    it('should release the estimate when blend throws', function() {
+        var before = blend.memoryUsage();
+        assert.throws(function() {
+            blend(images, { format: 'xbm' }, function() {});
+        }, /Invalid output format/);
+        assert.deepEqual(blend.memoryUsage().current, before.current);
+        assert.deepEqual(blend.memoryUsage().jobs, before.jobs);
+    });
+});
+
+describe('memory budget', function() {
+    var images = [
+        fs.readFileSync('test/fixture/1.png'),
+        fs.readFileSync('test/fixture/2.png')
+    ];
+    // Two 256x256 canvases plus one 256x256 layer.
+    var jobBytes = 256 * 256 * 4 * 3;
+
+    afterEach(function() {
+        blend.configure({ maxInFlightBytes: 0, maxQueued: Infinity });
+    });
+
+    it('should validate options', function() {
+        assert.throws(function() { blend.configure(); }, /options must be an object/);
+        assert.throws(function() { blend.configure({ maxInFlightBytes: -1 }); }, /maxInFlightBytes must be a number >= 0/);
+        assert.throws(function() { blend.configure({ maxQueued: 'a' }); }, /maxQueued must be a number >= 0/);
+    });
+
+    it('should queue jobs that exceed the budget', function(done) {
+        blend.configure({ maxInFlightBytes: jobBytes });
+        var before = blend.memoryUsage();
+        var remaining = 3;
+        for (var i = 0; i < 3; i++) {
+            blend(images, function(err, data) {
+                if (err) return done(err);
+                assert.ok(blend.memoryUsage().current <= jobBytes);
+                if (--remaining) return;
+                var after = blend.memoryUsage();
+                assert.equal(after.queued, 0);
+                assert.equal(after.waited, before.waited + 2);
+                done();
+            });
+        }
+        assert.equal(blend.memoryUsage().jobs, before.jobs + 1);
+        assert.equal(blend.memoryUsage().queued, 2);
+    });
+
+    it('should reject jobs larger than the budget', function(done) {
+        blend.configure({ maxInFlightBytes: jobBytes - 1 });
+        var before = blend.memoryUsage();
+        blend(images, function(err) {
+            assert.ok(err);
+            assert.ok(/exceeds maxInFlightBytes/.test(err.message));
+            assert.equal(blend.memoryUsage().rejected, before.rejected + 1);
+            done();
+        });
+    });
+
+    it('should reject jobs when the queue is full', function(done) {
+        blend.configure({ maxInFlightBytes: jobBytes, maxQueued: 0 });
+        var remaining = 2;
+        blend(images, function(err) {
+            if (err) return done(err);
+            if (!--remaining) done();
+        });
+        blend(images, function(err) {
+            assert.ok(err);
+            assert.ok(/Too many blend jobs waiting for memory/.test(err.message));
+            if (!--remaining) done();
+        });
+    });
+
+    it('should start queued jobs after configure() returns', function(done) {
+        blend.configure({ maxInFlightBytes: jobBytes });
+        var before = blend.memoryUsage();
+        var returned = false;
+        var remaining = 2;
+        function check(err) {
+            if (err) return done(err);
+            assert.ok(returned);
+            if (!--remaining) done();
+        }
+        blend(images, check);
+        blend(images, check);
+        blend.configure({ maxInFlightBytes: jobBytes * 2 });
+        assert.equal(blend.memoryUsage().jobs, before.jobs + 1);
+        returned = true;
+    });
+
+    it('should reject queued jobs that no longer fit after configure() returns', function(done) {
+        blend.configure({ maxInFlightBytes: jobBytes });
+        var returned = false;
+        var remaining = 2;
+        blend(images, function(err) {
+            if (err) return done(err);
+            if (!--remaining) done();
+        });
+        blend(images, function(err) {
+            assert.ok(returned);
+            assert.ok(/exceeds maxInFlightBytes/.test(err.message));
+            if (!--remaining) done();
+        });
+        blend.configure({ maxInFlightBytes: jobBytes - 1 });
+        returned = true;
+    });
+
+    it('should report validation errors of queued jobs to the callback', function(done) {
+        blend.configure({ maxInFlightBytes: jobBytes });
+        blend(images, function() {});
+        blend(images, { format: 'xbm' }, function(err) {
+            assert.ok(err);
+            assert.ok(/Invalid output format/.test(err.message));
+            done();
+        });
+    });
+});
@@ -0,0 +1,47 @@
+var assert = require('assert');
+var fs = require('fs');
+
+var blend = require('..');
+
+
+var images = [
+    fs.readFileSync('test/fixture/1.png'),
+    fs.readFileSync('test/fixture/2.png')
+];
+
+describe('per-job metrics', function() {
+    it('should not pass metrics unless asked', function(done) {
+        blend(images, { width: 256, height: 256 }, function(err, data, metrics) {
+            if (err) return done(err);
+            assert.equal(metrics, undefined);
+            done();
+        });
+    });
+
+    it('should report timings and sizes', function(done) {
+        blend(images, { width: 256, height: 256, metrics: true }, function(err, data, metrics) {
+            if (err) return done(err);
+            assert.deepEqual(Object.keys(metrics).sort(),
+                ['blend', 'bytesIn', 'bytesOut', 'layers', 'parse', 'total', 'wait']);
+            assert.equal(metrics.layers, 2);
+            assert.equal(metrics.bytesIn, images[0].length + images[1].length);
+            assert.equal(metrics.bytesOut, data.length);
+            assert.equal(metrics.wait, 0);
+            assert.ok(metrics.blend > 0);
+            assert.ok(metrics.total >= metrics.parse + metrics.blend);
+            done();
+        });
+    });
+
+    it('should report time spent waiting for memory', function(done) {
+        blend.configure({ maxInFlightBytes: 256 * 256 * 4 * 3 });
+        blend(images, function() {});
+        blend([ { buffer: images[0] }, { buffer: images[1] } ], { metrics: true }, function(err, data, metrics) {
+            blend.configure({ maxInFlightBytes: 0 });
+            if (err) return done(err);
+            assert.ok(metrics.wait > 0);
+            assert.equal(metrics.layers, 2);
+            done();
+        });
+    });
+});
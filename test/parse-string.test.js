@@ -61,3 +61,41 @@ describe('upgrading tint string', function() {
         });
     });
 });
+
+describe('tint string cache', function() {
+    it('returns the same frozen object for the same string', function() {
+        var a = blend.parseTintString('0.1x0.2;0.3x0.4');
+        var b = blend.parseTintString('0.1x0.2;0.3x0.4');
+        assert.strictEqual(a, b);
+        assert.ok(Object.isFrozen(a));
+        assert.ok(Object.isFrozen(a.h));
+    });
+
+    it('keeps old and new parses apart', function() {
+        assert.deepEqual(blend.parseTintStringOld('20'), { hue: 20 });
+        assert.deepEqual(blend.parseTintString('20'), { h: [20,20] });
+    });
+
+    it('keys upgrades by rounding', function() {
+        assert.equal(blend.upgradeTintString('20', 2), '0.05x0.05');
+        assert.equal(blend.upgradeTintString('20', 4), '0.0548x0.0548');
+    });
+
+    it('counts hits and misses in stats', function() {
+        blend.resetStats();
+        blend.parseTintString('0.5x0.6');
+        blend.parseTintString('0.5x0.6');
+        assert.deepEqual(blend.stats().tintCache, { hits: 1, misses: 1 });
+    });
+
+    it('evicts the least recently used string', function() {
+        var first = blend.parseTintString('0x0.1');
+        var second = blend.parseTintString('0x0.2');
+        for (var i = 0; i < 998; i++) blend.parseTintString(i + 'x1');
+        // Touch the first string so that the second one is evicted.
+        blend.parseTintString('0x0.1');
+        blend.parseTintString('999x1');
+        assert.strictEqual(blend.parseTintString('0x0.1'), first);
+        assert.notStrictEqual(blend.parseTintString('0x0.2'), second);
+    });
+});
@@ -0,0 +1,91 @@
+var assert = require('assert');
+var fs = require('fs');
+var os = require('os');
+var path = require('path');
+var mkdirp = require('mkdirp');
+var rimraf = require('rimraf');
+
+var blend = require('..');
+
+
+var images = [
+    fs.readFileSync('test/fixture/1.png'),
+    fs.readFileSync('test/fixture/2.png')
+];
+
+describe('workload recording', function() {
+    var root = path.join(os.tmpdir(), 'node-blend-record-' + process.pid);
+    var count = 0;
+    var dir;
+
+    // Recordings append, so every test gets a directory of its own.
+    beforeEach(function() {
+        dir = path.join(root, String(++count));
+        mkdirp.sync(root);
+    });
+
+    after(function() {
+        rimraf.sync(root);
+    });
+
+    it('should validate options', function() {
+        assert.throws(function() { blend.startRecording(); }, /options.dir must be a string/);
+        assert.throws(function() { blend.startRecording({ dir: dir, sampleRate: 2 }); }, /sampleRate must be a number between 0 and 1/);
+    });
+
+    it('should record calls and deduplicate buffers', function(done) {
+        blend.startRecording({ dir: dir });
+        assert.throws(function() { blend.startRecording({ dir: dir }); }, /Already recording/);
+        blend(images, function(err) {
+            if (err) return done(err);
+            blend([ { buffer: images[0], x: 10, y: 20 }, images[1] ], { width: 256, height: 256, format: 'jpeg' }, function(err) {
+                if (err) return done(err);
+                blend.stopRecording(function(err) {
+                    if (err) return done(err);
+                    var calls = fs.readFileSync(path.join(dir, 'calls.jsonl'), 'utf8').split('\n').filter(Boolean).map(JSON.parse);
+                    assert.equal(calls.length, 2);
+                    assert.equal(fs.readdirSync(path.join(dir, 'buffers')).length, 2);
+
+                    assert.equal(calls[0].options, undefined);
+                    assert.equal(calls[0].images.length, 2);
+                    assert.equal(calls[0].error, null);
+                    assert.deepEqual(calls[1].options, { width: 256, height: 256, format: 'jpeg' });
+                    assert.equal(calls[1].images[0].x, 10);
+                    assert.equal(calls[1].images[0].y, 20);
+                    assert.equal(calls[1].images[0].buffer, calls[0].images[0].buffer);
+                    assert.ok(calls[1].time >= calls[0].time);
+
+                    var stored = fs.readFileSync(path.join(dir, 'buffers', calls[0].images[0].buffer));
+                    assert.deepEqual(stored, images[0]);
+                    done();
+                });
+            });
+        });
+    });
+
+    it('should not record with a sample rate of 0', function(done) {
+        blend.startRecording({ dir: dir, sampleRate: 0 });
+        blend(images, function(err) {
+            if (err) return done(err);
+            blend.stopRecording(function(err) {
+                if (err) return done(err);
+                assert.equal(fs.readFileSync(path.join(dir, 'calls.jsonl'), 'utf8'), '');
+                done();
+            });
+        });
+    });
+
+    it('should report write errors from stopRecording', function(done) {
+        // The log can't be opened when its path is a directory.
+        mkdirp.sync(path.join(dir, 'calls.jsonl'));
+        blend.startRecording({ dir: dir });
+        blend(images, function(err) {
+            if (err) return done(err);
+            blend.stopRecording(function(err) {
+                assert.ok(err);
+                assert.equal(err.code, 'EISDIR');
+                done();
+            });
+        });
+    });
+});
@@ -0,0 +1,70 @@
+var assert = require('assert');
+var fs = require('fs');
+
+var blend = require('..');
+
+
+var images = [
+    fs.readFileSync('test/fixture/1.png'),
+    fs.readFileSync('test/fixture/1c.jpg'),
+    fs.readFileSync('test/fixture/9.webp')
+];
+
+describe('process-wide stats', function() {
+    beforeEach(function() {
+        blend.resetStats();
+    });
+
+    it('should start out empty', function() {
+        var stats = blend.stats();
+        assert.equal(stats.jobs, 0);
+        assert.equal(stats.errors, 0);
+        assert.equal(stats.passthrough, 0);
+        assert.equal(stats.pixels, 0);
+        assert.deepEqual(stats.decoded, { png: 0, jpeg: 0, webp: 0, unknown: 0 });
+        assert.deepEqual(stats.encoded, { png: 0, jpeg: 0, webp: 0 });
+        assert.equal(stats.latency.counts.length, stats.latency.bounds.length + 1);
+    });
+
+    it('should count decoded and encoded formats', function(done) {
+        blend(images, { width: 256, height: 256, format: 'jpeg' }, function(err) {
+            if (err) return done(err);
+            var stats = blend.stats();
+            assert.equal(stats.jobs, 1);
+            assert.deepEqual(stats.decoded, { png: 1, jpeg: 1, webp: 1, unknown: 0 });
+            assert.deepEqual(stats.encoded, { png: 0, jpeg: 1, webp: 0 });
+            assert.equal(stats.pixels, 256 * 256);
+            assert.equal(stats.latency.counts.reduce(function(a, b) { return a + b; }), 1);
+            done();
+        });
+    });
+
+    it('should count passthrough results', function(done) {
+        blend([ images[0] ], function(err, data) {
+            if (err) return done(err);
+            assert.deepEqual(data, images[0]);
+            var stats = blend.stats();
+            assert.equal(stats.passthrough, 1);
+            assert.deepEqual(stats.encoded, { png: 0, jpeg: 0, webp: 0 });
+            done();
+        });
+    });
+
+    it('should count errors', function(done) {
+        var buffer = new Buffer(1024);
+        buffer.fill(0);
+        blend([ buffer, buffer ], function(err) {
+            assert.ok(err);
+            var stats = blend.stats();
+            assert.equal(stats.jobs, 1);
+            assert.equal(stats.errors, 1);
+            done();
+        });
+    });
+
+    it('should return a snapshot', function() {
+        var stats = blend.stats();
+        stats.jobs = 100;
+        assert.equal(blend.stats().jobs, 0);
+    });
+});
@@ -0,0 +1,65 @@
+var assert = require('assert');
+var fs = require('fs');
+var os = require('os');
+var path = require('path');
+var spawn = require('child_process').spawn;
+var mkdirp = require('mkdirp');
+var rimraf = require('rimraf');
+
+var hasTraceEvents = true;
+try { require('trace_events'); } catch (err) { hasTraceEvents = false; }
+
+// Runs one blend() in a child process started with `flags` and calls back
+// with the trace log it wrote, or '' if there is none.
+function traceRun(dir, flags, callback) {
+    var script = [
+        'var fs = require("fs");',
+        'var blend = require(' + JSON.stringify(path.resolve(__dirname, '..')) + ');',
+        'var images = [',
+        '    fs.readFileSync(' + JSON.stringify(path.resolve(__dirname, 'fixture/1.png')) + '),',
+        '    fs.readFileSync(' + JSON.stringify(path.resolve(__dirname, 'fixture/2.png')) + ')',
+        '];',
+        'blend(images, function(err) { if (err) throw err; });'
+    ].join('\n');
+    var child = spawn(process.execPath, flags.concat(['-e', script]), { cwd: dir, env: process.env, stdio: 'inherit' });
+    child.on('exit', function(code) {
+        if (code !== 0) return callback(new Error('child exited with code ' + code));
+        var log = path.join(dir, 'node_trace.1.log');
+        callback(null, fs.existsSync(log) ? fs.readFileSync(log, 'utf8') : '');
+    });
+}
+
+describe('tracing', function() {
+    if (!hasTraceEvents) return it('is not supported on this version of node');
+
+    var dir = path.join(os.tmpdir(), 'node-blend-trace-' + process.pid);
+
+    beforeEach(function() {
+        rimraf.sync(dir);
+        mkdirp.sync(dir);
+    });
+
+    after(function() {
+        rimraf.sync(dir);
+    });
+
+    it('should emit spans when node.console is enabled', function(done) {
+        this.timeout(10000);
+        traceRun(dir, ['--trace-event-categories', 'node.console'], function(err, log) {
+            if (err) return done(err);
+            var names = JSON.parse(log).traceEvents.map(function(event) { return event.name; });
+            assert.ok(names.some(function(name) { return /^time::node-blend\.job #1 \(2 layers, /.test(name); }), 'job span');
+            assert.ok(names.some(function(name) { return /^time::node-blend\.blend #1 /.test(name); }), 'blend span');
+            done();
+        });
+    });
+
+    it('should emit nothing when tracing is disabled', function(done) {
+        this.timeout(10000);
+        traceRun(dir, [], function(err, log) {
+            if (err) return done(err);
+            assert.equal(log.indexOf('node-blend.'), -1);
+            done();
+        });
+    });
+});